@@ -0,0 +1,206 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Run f repetitions times and return the fastest run in seconds
+ */
+template <class F>
+double measure(F&& f, int repetitions = 5) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+
+  return best;
+}
+
+/**
+ * Print the throughput of processing bytes in seconds
+ */
+inline void report(std::string_view name, std::size_t bytes, double seconds) {
+  double mb = static_cast<double>(bytes) / (1024 * 1024);
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(3) << std::setw(10) << seconds * 1000
+            << " ms " << std::setw(10) << mb / seconds << " MB/s" << std::endl;
+}
+
+/**
+ * The fastest run of a benchmark that processed bytes or items, the other one
+ * is 0
+ */
+struct Measurement {
+  std::string name;
+  double seconds = 0;
+  double bytes = 0;
+  double items = 0;
+
+  /**
+   * Bytes per second if it processed bytes else items per second
+   */
+  double throughput() const { return (bytes != 0 ? bytes : items) / seconds; }
+};
+
+/**
+ * Print the throughput of the measurement in MB/s or items/s
+ */
+inline void report(Measurement const& m) {
+  if (m.bytes != 0) {
+    report(m.name, static_cast<std::size_t>(m.bytes), m.seconds);
+    return;
+  }
+
+  std::cout << std::left << std::setw(40) << m.name << std::right << std::fixed
+            << std::setprecision(3) << std::setw(10) << m.seconds * 1000
+            << " ms " << std::setw(10) << m.throughput() << " items/s"
+            << std::endl;
+}
+
+// the numbers of an optimized build can only be compared to optimized ones
+#ifdef __OPTIMIZE__
+constexpr bool optimized = true;
+#else
+constexpr bool optimized = false;
+#endif
+
+/**
+ * Measurements and whether they were taken by an optimized build
+ */
+struct Report {
+  bool optimized = bench::optimized;
+  std::vector<Measurement> results;
+};
+
+/**
+ * Write the measurements as JSON in the layout of Google Benchmark
+ */
+inline void write_json(std::ostream& out, Report const& report) {
+  auto& results = report.results;
+  out << "{\n  \"context\": {\"library_build_type\": \""
+      << (report.optimized ? "release" : "debug")
+      << "\"},\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto& result = results[i];
+    out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name
+        << "\", \"real_time\": " << std::setprecision(6) << std::fixed
+        << result.seconds * 1000 << ", \"time_unit\": \"ms\", \""
+        << (result.bytes != 0 ? "bytes_per_second" : "items_per_second")
+        << "\": " << std::setprecision(1) << result.throughput() << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+/**
+ * Read the name and throughput of the benchmarks written by write_json, only
+ * that layout is understood
+ */
+inline Report read_json(std::istream& in) {
+  std::string json{std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>()};
+  Report report;
+  report.optimized =
+      json.find("\"library_build_type\": \"release\"") != std::string::npos;
+
+  auto value_after = [&json](std::string_view key, std::size_t from,
+                             std::size_t to) {
+    auto found = json.find(key, from);
+    return found < to ? found + key.size() : std::string::npos;
+  };
+
+  auto& results = report.results;
+  for (auto object = json.find('{', json.find('[')); object != std::string::npos;
+       object = json.find('{', object + 1)) {
+    auto object_end = json.find('}', object);
+    auto name = value_after("\"name\": \"", object, object_end);
+    if (name == std::string::npos) {
+      continue;
+    }
+
+    Measurement result;
+    result.name = json.substr(name, json.find('"', name) - name);
+    result.seconds = 1;
+    if (auto bytes = value_after("\"bytes_per_second\": ", object, object_end);
+        bytes != std::string::npos) {
+      result.bytes = std::strtod(json.c_str() + bytes, nullptr);
+    } else if (auto items =
+                   value_after("\"items_per_second\": ", object, object_end);
+               items != std::string::npos) {
+      result.items = std::strtod(json.c_str() + items, nullptr);
+    }
+    results.push_back(std::move(result));
+  }
+
+  return report;
+}
+
+/**
+ * Print how the results compare to the baseline ones of the same name
+ *
+ * Returns false if any is slower than (1 - tolerance) times its baseline,
+ * results of another build type than the baseline are not compared
+ */
+inline bool compare(Report const& report, Report const& baseline_report,
+                    double tolerance) {
+  if (report.optimized != baseline_report.optimized) {
+    std::cout << "the baseline is of another build type, not compared"
+              << std::endl;
+    return true;
+  }
+
+  auto& baseline = baseline_report.results;
+  bool ok = true;
+  for (auto& result : report.results) {
+    auto base = std::find_if(baseline.begin(), baseline.end(),
+                             [&](auto& b) { return b.name == result.name; });
+    if (base == baseline.end() || !(base->throughput() > 0)) {
+      std::cout << std::left << std::setw(40) << result.name
+                << " no baseline" << std::endl;
+      continue;
+    }
+
+    auto ratio = result.throughput() / base->throughput();
+    bool slower = ratio < 1 - tolerance;
+    ok = ok && !slower;
+    std::cout << std::left << std::setw(40) << result.name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10) << ratio
+              << "x baseline" << (slower ? " REGRESSION" : "") << std::endl;
+  }
+
+  return ok;
+}
+
+/**
+ * Keep the compiler from optimizing away a computed value
+ */
+template <class T>
+void do_not_optimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  // no inline assembly e.g. MSVC on x64, a volatile read needs the value in
+  // memory
+  static_cast<void>(*reinterpret_cast<const volatile char*>(&value));
+#endif
+}
+
+}  // namespace bench
+
+#endif  //! BENCH_H
@@ -0,0 +1,43 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <source.hpp>
+#include <std_parser.hpp>
+
+#include "bench.hpp"
+#include "corpus.hpp"
+
+/**
+ * Parse a header of a corpus with the std parser, built with
+ * ZERO_PREPROCESSOR_PROFILE_GRAMMAR so the use of every rule is reported at
+ * exit
+ */
+int main(int argc, char* argv[]) {
+  corpus::Parameters p;
+  p.classes_per_file = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+  p.headers = 1;
+
+  // NOTE: a header, the sources define a meta class the std parser skips
+  auto content =
+      std::make_shared<const std::string>(corpus::generate_header(0, p));
+  Source source{content, "corpus"};
+  std_parser::StdParser parser;
+  auto seconds = bench::measure(
+      [&] {
+        while (!source.is_finished()) {
+          auto out = parser.parse(source);
+          if (!out) {
+            std::cerr << "can't parse the corpus" << std::endl;
+            std::exit(EXIT_FAILURE);
+          }
+          source.advance(std::distance(source.begin(), out->processed_to));
+        }
+      },
+      1);
+
+  bench::report("std_parser parse profiled", content->size(), seconds);
+  std::cerr << std::endl;
+  return 0;
+}
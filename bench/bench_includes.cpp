@@ -0,0 +1,70 @@
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+
+#include <std_parser.hpp>
+
+#include "bench.hpp"
+
+/**
+ * A header like source of roughly size bytes with a few includes
+ */
+std::string generate_source(std::size_t size) {
+  std::string block = "#pragma once\n#include <vector>\n#include \"a.hpp\"\n";
+  for (int i = 0; i < 100; ++i) {
+    block += "struct S" + std::to_string(i) + " {\n";
+    block += "  int a; // #include \"not_an_include.hpp\"\n";
+    block += "  std::vector<int> v;\n  void foo(int b) const;\n";
+    block += "};\n";
+  }
+
+  std::string source;
+  while (source.size() < size) {
+    source += block;
+  }
+  return source;
+}
+
+struct StringSource {
+  std::string const& content;
+
+  auto begin() const { return content.begin(); }
+  auto end() const { return content.end(); }
+};
+
+/**
+ * Run the include grammar on every line, how get_includes used to work
+ */
+auto get_includes_by_line(StringSource source) {
+  namespace x3 = boost::spirit::x3;
+  namespace rules = std_parser::rules;
+
+  std::unordered_set<std::string> includes;
+  auto inc = [&includes](auto& ctx) { includes.emplace(_attr(ctx)); };
+
+  auto begin = source.begin();
+  auto end = source.end();
+  while (begin != end) {
+    x3::parse(begin, end,
+              rules::some_space | rules::include[inc] | rules::skip_line);
+  }
+  return includes;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t size_mb = argc > 1 ? std::atoi(argv[1]) : 64;
+  auto content = generate_source(size_mb * 1024 * 1024);
+  StringSource source{content};
+
+  auto scanned = bench::measure([&] {
+    std_parser::StdParserState parser;
+    bench::do_not_optimize(parser.get_includes(source).size());
+  });
+  bench::report("get_includes", content.size(), scanned);
+
+  auto by_line = bench::measure(
+      [&] { bench::do_not_optimize(get_includes_by_line(source).size()); });
+  bench::report("include grammar on every line", content.size(), by_line);
+
+  return 0;
+}
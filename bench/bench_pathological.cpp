@@ -0,0 +1,93 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <source.hpp>
+#include <std_parser.hpp>
+
+#include "bench.hpp"
+
+/**
+ * open depth times, then leaf, then close depth times
+ */
+std::string nest(std::string const& open, std::string const& close,
+                 std::string const& leaf, int depth) {
+  std::string nested;
+  for (int i = 0; i < depth; ++i) {
+    nested += open;
+  }
+  nested += leaf;
+  for (int i = 0; i < depth; ++i) {
+    nested += close;
+  }
+  return nested;
+}
+
+/**
+ * Inputs where every '<' is first tried as the start of template values
+ */
+struct Input {
+  const char* name;
+  std::string (*generate)(int depth);
+};
+
+const Input inputs[] = {
+    // a chain of comparisons, no '<' is ever closed
+    {"comparisons",
+     [](int depth) {
+       std::string chain = "a";
+       for (int i = 0; i < depth; ++i) {
+         chain += " < b";
+       }
+       return "void f() { bool b = " + chain + "; }\n";
+     }},
+    // the template values fail at the call and are parsed as comparisons
+    {"template call",
+     [](int depth) {
+       return "void g(int a = " + nest("f<A<", ">>(1)", "2", depth) + ");\n";
+     }},
+    // nested template values that do parse, the cost of the memo table
+    {"nested templates",
+     [](int depth) {
+       return "struct A { " +
+              nest("std::map<std::pair<int, ", ">, int>", "int", depth) +
+              " m; };\n";
+     }},
+};
+
+void parse(std::shared_ptr<const std::string> const& content, bool memoize) {
+  Source source{content, "pathological"};
+  std_parser::StdParser parser;
+  parser.set_memoization(memoize);
+  while (!source.is_finished()) {
+    auto out = parser.parse(source);
+    if (!out) {
+      break;
+    }
+    source.advance(std::distance(source.begin(), out->processed_to));
+  }
+  bench::do_not_optimize(parser.get_all_code_fragments().size());
+}
+
+int main(int argc, char* argv[]) {
+  int max_depth = argc > 1 ? std::atoi(argv[1]) : 256;
+
+  // with the memo table the time should grow about linearly with the depth
+  for (auto& input : inputs) {
+    for (int depth = 16; depth <= max_depth; depth *= 2) {
+      auto content =
+          std::make_shared<const std::string>(input.generate(depth));
+      auto name = std::string{input.name} + " " + std::to_string(depth);
+
+      auto memoized = bench::measure([&] { parse(content, true); });
+      bench::report(name + " memoized", content->size(), memoized);
+
+      auto plain = bench::measure([&] { parse(content, false); });
+      bench::report(name, content->size(), plain);
+    }
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
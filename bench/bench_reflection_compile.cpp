@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+#include <static_reflection.hpp>
+#include <std_parser.hpp>
+
+namespace fs = std::filesystem;
+
+/**
+ * Structs with members of a few types, the last ones private, and an enum
+ */
+std::string generate_types(std::size_t structs, std::size_t members) {
+  std::string out = "#include <string>\n#include <vector>\n";
+  for (std::size_t i = 0; i < structs; ++i) {
+    auto n = std::to_string(i);
+    out += "struct S" + n + " {\n";
+    for (std::size_t j = 0; j < members; ++j) {
+      if (j == members - members / 4) {
+        out += " private:\n";
+      }
+      auto m = std::to_string(j);
+      switch (j % 3) {
+        case 0:
+          out += "  int m" + m + ";\n";
+          break;
+        case 1:
+          out += "  std::string m" + m + ";\n";
+          break;
+        default:
+          out += "  std::vector<int> m" + m + ";\n";
+          break;
+      }
+    }
+    out += "};\n";
+  }
+
+  out += "enum class E {";
+  for (std::size_t j = 0; j < members; ++j) {
+    out += " e" + std::to_string(j) + ',';
+  }
+  out.back() = ' ';
+  out += "};\n";
+  return out;
+}
+
+/**
+ * A source that walks the names and types of the members of every struct and
+ * the enumerators, like a serializer would
+ */
+std::string generate_consumer(std::size_t structs) {
+  std::string out =
+      "#include <string_view>\n#include <utility>\n"
+      "#include \"types.hpp\"\n\n"
+      "template <class List, std::size_t... Is>\n"
+      "std::size_t walk(std::index_sequence<Is...>) {\n"
+      "  return (0 + ... + (sizeof(reflect::get_type_t<\n"
+      "                         reflect::get_element_t<Is, List>>) +\n"
+      "                     std::string_view{reflect::get_name_v<\n"
+      "                         reflect::get_element_t<Is, List>>}\n"
+      "                         .size()));\n"
+      "}\n\n"
+      "template <class List>\n"
+      "std::size_t walk() {\n"
+      "  return walk<List>(std::make_index_sequence<reflect::get_size_v<"
+      "List>>{});\n"
+      "}\n\n"
+      "std::size_t walk_all() {\n"
+      "  std::size_t size = "
+      "walk<reflect::get_enumerators_t<reflexpr<E>>>();\n";
+  for (std::size_t i = 0; i < structs; ++i) {
+    auto meta = "reflexpr<S" + std::to_string(i) + ">";
+    out += "  size += walk<reflect::get_data_members_t<" + meta + ">>();\n";
+    out += "  size += walk<reflect::get_public_data_members_t<" + meta +
+           ">>();\n";
+  }
+  out += "  return size;\n}\n";
+  return out;
+}
+
+/**
+ * Write the types with their reflection in the layout to dir
+ */
+void write_reflection(fs::path const& dir, fs::path const& types,
+                      static_reflection::Layout layout) {
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  auto static_ref = [layout](auto& parent) {
+    return static_reflection::StaticReflexParser{parent, layout};
+  };
+  Preprocessor preprocessor(source::SourceLoader{{}, ""}, static_ref,
+                            std_parser);
+  std::string processed;
+  auto writer = [&processed](auto& src) {
+    processed.append(std::begin(src), std::end(src));
+  };
+  preprocessor.process_source(types.string(), writer);
+
+  fs::create_directories(dir);
+  std::ofstream(dir / "types.hpp", std::ios::out | std::ios::binary)
+      << processed;
+}
+
+/**
+ * The fastest of the compilations of the consumer with the types of dir
+ */
+double compile(fs::path const& dir, fs::path const& consumer,
+               int repetitions) {
+  auto command = std::string{BENCH_CXX_COMPILER} +
+                 " -std=c++17 -c -I\"" BENCH_REFLECT_INCLUDE "\" -I\"" +
+                 dir.string() + "\" \"" + consumer.string() + "\" -o \"" +
+                 (dir / "consumer.o").string() + '"';
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    if (std::system(command.c_str()) != 0) {
+      std::cerr << "can't compile: " << command << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+/**
+ * Compare how long a source using the reflection of large structs takes to
+ * compile with the tuple and with the flat layout
+ */
+int main(int argc, char* argv[]) {
+  std::size_t structs = 4;
+  std::size_t members = 128;
+  int repetitions = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string_view arg = argv[i];
+    auto value = std::strtoul(argv[i + 1], nullptr, 10);
+    if (arg == "--structs") {
+      structs = value;
+    } else if (arg == "--members") {
+      members = value;
+    } else if (arg == "--repetitions") {
+      repetitions = value;
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--structs 4] [--members 128] [--repetitions 1]"
+                << std::endl;
+      return 2;
+    }
+  }
+
+  auto root = fs::temp_directory_path() / "zero_preprocessor_reflection";
+  fs::remove_all(root);
+  // NOTE: not beside the consumer, it would include it instead of the output
+  fs::create_directories(root / "source");
+  auto types = root / "source" / "types.hpp";
+  std::ofstream(types, std::ios::out | std::ios::binary)
+      << generate_types(structs, members);
+  auto consumer = root / "consumer.cpp";
+  std::ofstream(consumer, std::ios::out | std::ios::binary)
+      << generate_consumer(structs);
+
+  write_reflection(root / "tuple", types, static_reflection::Layout::Tuple);
+  write_reflection(root / "flat", types, static_reflection::Layout::Flat);
+
+  auto tuple = compile(root / "tuple", consumer, repetitions);
+  auto flat = compile(root / "flat", consumer, repetitions);
+
+  std::cout << structs << " structs of " << members << " members\n"
+            << std::fixed << std::setprecision(3) << std::left
+            << std::setw(20) << "tuple layout" << tuple << " s\n"
+            << std::setw(20) << "flat layout" << flat << " s\n"
+            << std::setprecision(1) << std::setw(20) << "reduction"
+            << 100 * (1 - flat / tuple) << " %" << std::endl;
+
+  fs::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,209 @@
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <meta_classes.hpp>
+#include <meta_process_pool.hpp>
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+#include <static_reflection.hpp>
+#include <std_parser.hpp>
+
+#include "bench.hpp"
+#include "corpus.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * The time of processing the first source of the corpus with all the parsers
+ * and its size, the meta classes are generated by the pool if there is one
+ */
+bench::Measurement time_process(corpus::Parameters const& p,
+                                meta_classes::MetaProcessPool* pool,
+                                int repetitions) {
+  auto path = fs::temp_directory_path() / "zero_preprocessor_scaling.cpp";
+  auto source = corpus::generate_source(0, p);
+  std::ofstream(path, std::ios::out | std::ios::binary) << source;
+
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  auto static_ref = [](auto& parent) {
+    return static_reflection::StaticReflexParser{parent};
+  };
+  auto seconds = bench::measure(
+      [&] {
+        std::string processed;
+        auto writer = [&processed](auto& src) {
+          processed.append(std::begin(src), std::end(src));
+        };
+        if (pool != nullptr) {
+          auto meta_classes = [pool](auto& parent) {
+            return meta_classes::MetaClassParser{parent, *pool, ""};
+          };
+          Preprocessor preprocessor(source::SourceLoader{{}, ""}, meta_classes,
+                                    static_ref, std_parser);
+          preprocessor.process_source(path.string(), writer);
+        } else {
+          auto meta_classes = [](auto& parent) {
+            return meta_classes::MetaClassParser{parent, "", ""};
+          };
+          Preprocessor preprocessor(source::SourceLoader{{}, ""}, meta_classes,
+                                    static_ref, std_parser);
+          preprocessor.process_source(path.string(), writer);
+        }
+        bench::do_not_optimize(processed.size());
+      },
+      repetitions);
+
+  fs::remove(path);
+  return {"", seconds, static_cast<double>(source.size()), 0};
+}
+
+/**
+ * The time of finding the dependencies of the first source of a corpus
+ * written to the temp dir and the size of the corpus
+ */
+bench::Measurement time_dependencies(corpus::Parameters const& p,
+                                     int repetitions) {
+  auto root = fs::temp_directory_path() / "zero_preprocessor_scaling";
+  fs::remove_all(root);
+  auto files = corpus::generate(p);
+  double bytes = 0;
+  for (auto& file : files) {
+    bytes += file.content.size();
+  }
+  corpus::write(root, files);
+  // stands in for the reflection header the preprocessor generates
+  corpus::write(root, {{"reflect/reflect.hpp", ""}});
+
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  auto source = (root / "src" / "s0.cpp").string();
+  auto seconds = bench::measure(
+      [&] {
+        Preprocessor preprocessor(
+            source::SourceLoader{
+                {(root / "include").string(), (root / "reflect").string()},
+                ""},
+            std_parser);
+        std::size_t count = 0;
+        auto writer = [&count](auto&) { ++count; };
+        preprocessor.get_dependencies(source, writer);
+        bench::do_not_optimize(count);
+      },
+      repetitions);
+
+  fs::remove_all(root);
+  return {"", seconds, bytes, 0};
+}
+
+struct Sweep {
+  std::string name;
+  // the parameter doubled at every step
+  std::size_t corpus::Parameters::*parameter;
+  std::size_t first;
+  bool dependencies;
+};
+
+int main(int argc, char* argv[]) {
+  bool quick = false;
+  std::string json_path;
+  std::string meta_exe;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--quick") {
+      quick = true;
+    } else if (arg == "--json" && has_value) {
+      json_path = argv[++i];
+    } else if (arg == "--meta" && has_value) {
+      meta_exe = argv[++i];
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--quick] [--json out] [--meta meta_exe]" << std::endl;
+      return 2;
+    }
+  }
+
+  // the meta classes are only generated with the meta executable of
+  // bench/meta_classes.cpp, without it the sources don't use them
+  std::unique_ptr<meta_classes::MetaProcessPool> pool;
+  corpus::Parameters fixed;
+  fixed.headers = 64;
+  if (!meta_exe.empty()) {
+#ifdef SIGPIPE
+    // like main, a write to a meta process that exited mustn't kill the bench
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    pool = std::make_unique<meta_classes::MetaProcessPool>(meta_exe, 1);
+  } else {
+    fixed.meta_classes_per_file = 0;
+  }
+
+  std::vector<Sweep> sweeps = {
+      {"classes", &corpus::Parameters::classes_per_file, 16, false},
+      {"members", &corpus::Parameters::members_per_class, 8, false},
+      {"depth", &corpus::Parameters::nesting_depth, 2, false},
+      {"headers", &corpus::Parameters::headers, 32, true},
+      {"fan-out", &corpus::Parameters::include_fan_out, 2, true},
+  };
+  if (pool) {
+    sweeps.push_back(
+        {"meta", &corpus::Parameters::meta_classes_per_file, 4, false});
+  }
+
+  int steps = quick ? 3 : 5;
+  int repetitions = quick ? 3 : 5;
+  bench::Report report;
+  bool linear = true;
+  std::cout << std::left << std::setw(24) << "parameter" << std::right
+            << std::setw(10) << "value" << std::setw(14) << "time"
+            << std::setw(12) << "exponent" << std::endl;
+  for (auto& sweep : sweeps) {
+    double previous = 0;
+    for (int step = 0; step < steps; ++step) {
+      auto p = fixed;
+      auto value = sweep.first << step;
+      p.*sweep.parameter = value;
+      auto measurement = sweep.dependencies
+                             ? time_dependencies(p, repetitions)
+                             : time_process(p, pool.get(), repetitions);
+      auto seconds = measurement.seconds;
+
+      // the slope of the log log curve between two steps, 1 is linear
+      std::cout << std::left << std::setw(24) << sweep.name << std::right
+                << std::setw(10) << value << std::setw(12) << std::fixed
+                << std::setprecision(2) << seconds * 1000 << "ms";
+      if (step > 0) {
+        auto exponent = std::log2(seconds / previous);
+        std::cout << std::setw(12) << exponent;
+        if (exponent > 1.5) {
+          std::cout << "  super-linear";
+          linear = false;
+        }
+      }
+      std::cout << std::endl;
+
+      measurement.name = sweep.name + " " + std::to_string(value);
+      report.results.push_back(measurement);
+      previous = seconds;
+    }
+  }
+
+  if (!json_path.empty()) {
+    std::ofstream out(json_path);
+    bench::write_json(out, report);
+  }
+
+  if (!linear) {
+    std::cout << std::endl
+              << "some parameters grow super-linearly, see above" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <source_loader.hpp>
+
+#include "bench.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * Write a header like file of roughly size bytes
+ */
+void generate_source(fs::path const& path, std::size_t size) {
+  std::ofstream out(path, std::ios::out | std::ios::binary);
+  std::string block;
+  for (int i = 0; i < 100; ++i) {
+    block += "struct S" + std::to_string(i) + " {\n";
+    block += "  int a;\n  std::vector<int> v;\n  void foo(int b) const;\n";
+    block += "};\n";
+  }
+
+  for (std::size_t written = 0; written < size; written += block.size()) {
+    out << block;
+  }
+}
+
+/**
+ * Touch every character of the source the same way the parsers do
+ */
+std::size_t count_lines(Source& source) {
+  std::size_t lines = 0;
+  for (auto c : source) {
+    lines += c == '\n';
+  }
+  return lines;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t size_mb = argc > 1 ? std::atoi(argv[1]) : 64;
+  auto path = fs::temp_directory_path() / "zero_preprocessor_bench_source.hpp";
+  generate_source(path, size_mb * 1024 * 1024);
+  std::size_t bytes = fs::file_size(path);
+
+  source::SourceLoader loader{{}, "include"};
+
+  auto mapped = bench::measure([&] {
+    auto source = loader.load_source(path);
+    bench::do_not_optimize(count_lines(source));
+  });
+  bench::report("load_source (mmap)", bytes, mapped);
+
+  auto copied = bench::measure([&] {
+    auto source = loader.read_source(path);
+    bench::do_not_optimize(count_lines(source));
+  });
+  bench::report("read_source (owning string)", bytes, copied);
+
+  fs::remove(path);
+  return 0;
+}
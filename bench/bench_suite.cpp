@@ -0,0 +1,212 @@
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <meta_classes.hpp>
+#include <meta_process_pool.hpp>
+#include <preprocessor.hpp>
+#include <source.hpp>
+#include <source_loader.hpp>
+#include <static_reflection.hpp>
+#include <std_parser.hpp>
+
+#include "bench.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * An include and a namespace with a class, its functions and an enum, all the
+ * parsers understand it
+ */
+std::string generate_block(int i) {
+  auto n = std::to_string(i);
+  return "// block " + n + "\n#include \"ns" + n +
+         ".hpp\"\n"
+         "namespace ns" +
+         n + " {\nstruct S" + n +
+         " : public Base<int, std::string> {\n"
+         "  int a;\n  std::vector<std::string> names;\n  S" +
+         n +
+         "(int a) : a{a} {}\n"
+         "  virtual int get_area() const override { return a * a; }\n"
+         "  std::map<std::string, std::vector<int>> const& get(int const x, "
+         "std::string&& y) const noexcept;\n"
+         "  void foo(int b) { if (b > 2) { a = b; } for (int i = 0; i < b; "
+         "++i) { a += i; } }\n"
+         "};\nenum class E" +
+         n + " { A, B, C };\n}\n";
+}
+
+std::string generate_source(std::size_t size) {
+  std::string source = "#include <map>\n#include <string>\n";
+  for (int i = 0; source.size() < size; ++i) {
+    source += generate_block(i);
+  }
+  return source;
+}
+
+struct StringSource {
+  std::string const& content;
+
+  auto begin() const { return content.begin(); }
+  auto end() const { return content.end(); }
+};
+
+void parse_all(std::shared_ptr<const std::string> const& content) {
+  Source source{content, "bench"};
+  std_parser::StdParser parser;
+  while (!source.is_finished()) {
+    auto out = parser.parse(source);
+    if (!out) {
+      std::cerr << "can't parse the generated source" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    source.advance(std::distance(source.begin(), out->processed_to));
+  }
+  bench::do_not_optimize(parser.get_all_code_fragments().size());
+}
+
+template <class... Functions>
+std::size_t process(fs::path const& path, Functions... funs) {
+  Preprocessor preprocessor(source::SourceLoader{{}, ""}, funs...);
+  std::string processed;
+  auto writer = [&processed](auto& src) {
+    processed.append(std::begin(src), std::end(src));
+  };
+  preprocessor.process_source(path.string(), writer);
+  return processed.size();
+}
+
+/**
+ * Generate value_type classes with the meta executable one at a time
+ */
+void round_trips(meta_classes::MetaProcessPool& pool,
+                 std_parser::rules::ast::Class const& cls, int count) {
+  auto reporter = [](std::string_view msg) { std::cerr << msg << std::endl; };
+  for (int i = 0; i < count; ++i) {
+    auto copy = cls;
+    auto generated = pool.generate("value_type", copy, reporter).get();
+    bench::do_not_optimize(generated.size());
+  }
+}
+
+int main(int argc, char* argv[]) {
+  bool quick = false;
+  std::string json_path;
+  std::string baseline_path;
+  std::string meta_exe;
+  double tolerance = 0.5;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--quick") {
+      quick = true;
+    } else if (arg == "--json" && has_value) {
+      json_path = argv[++i];
+    } else if (arg == "--baseline" && has_value) {
+      baseline_path = argv[++i];
+    } else if (arg == "--tolerance" && has_value) {
+      tolerance = std::atof(argv[++i]);
+    } else if (arg == "--meta" && has_value) {
+      meta_exe = argv[++i];
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--quick] [--json out] [--baseline in] [--tolerance 0.5]"
+                   " [--meta meta_exe]"
+                << std::endl;
+      return 2;
+    }
+  }
+
+  auto content = std::make_shared<const std::string>(
+      generate_source(quick ? 512 * 1024 : 4 * 1024 * 1024));
+  double bytes = content->size();
+  int repetitions = quick ? 3 : 5;
+
+  auto path = fs::temp_directory_path() / "zero_preprocessor_bench_suite.hpp";
+  std::ofstream(path, std::ios::out | std::ios::binary) << *content;
+
+  bench::Report report;
+  auto run = [&](std::string name, double bytes, double items, auto&& f) {
+    bench::Measurement m{std::move(name), bench::measure(f, repetitions),
+                         bytes, items};
+    bench::report(m);
+    report.results.push_back(std::move(m));
+  };
+
+  run("std_parser parse", bytes, 0, [&] { parse_all(content); });
+
+  run("get_includes", bytes, 0, [&] {
+    StringSource source{*content};
+    std_parser::StdParserState parser;
+    bench::do_not_optimize(parser.get_includes(source).size());
+  });
+
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  auto static_ref = [](auto& parent) {
+    return static_reflection::StaticReflexParser{parent};
+  };
+  auto meta_classes = [](auto& parent) {
+    return meta_classes::MetaClassParser{parent, "", ""};
+  };
+
+  run("process_source std_parser", bytes, 0,
+      [&] { bench::do_not_optimize(process(path, std_parser)); });
+
+  // the generation of the reflection of every class
+  run("process_source static_reflection", bytes, 0,
+      [&] { bench::do_not_optimize(process(path, static_ref, std_parser)); });
+
+  run("process_source all parsers", bytes, 0, [&] {
+    bench::do_not_optimize(
+        process(path, meta_classes, static_ref, std_parser));
+  });
+
+  fs::remove(path);
+
+  if (!meta_exe.empty()) {
+#ifdef SIGPIPE
+    // like main, a write to a meta process that exited mustn't kill the bench
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    meta_classes::MetaProcessPool pool{meta_exe, 1};
+    std::string class_source =
+        "struct Point { int x; int y; std::string name; };";
+    std_parser::StdParser parser;
+    auto cls = parser.try_parse_entire_class(class_source.begin(),
+                                             class_source.end());
+    if (!cls.result) {
+      std::cerr << "can't parse the meta class input" << std::endl;
+      return 1;
+    }
+
+    int count = quick ? 200 : 1000;
+    run("meta class round trip", 0, count,
+        [&] { round_trips(pool, *cls.result, count); });
+  }
+
+  if (!json_path.empty()) {
+    std::ofstream out(json_path);
+    bench::write_json(out, report);
+  }
+
+  if (!baseline_path.empty()) {
+    std::ifstream in(baseline_path);
+    if (!in) {
+      std::cerr << "can't read the baseline " << baseline_path << std::endl;
+      return 1;
+    }
+
+    std::cout << std::endl;
+    return bench::compare(report, bench::read_json(in), tolerance) ? 0 : 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <source.hpp>
+#include <std_parser.hpp>
+
+#include "bench.hpp"
+#include "corpus.hpp"
+
+/**
+ * Parse the content with or without the tokens of the statement loop
+ */
+void parse(std::shared_ptr<const std::string> const& content, bool tokenize) {
+  Source source{content, "corpus"};
+  std_parser::StdParser parser;
+  parser.set_tokenization(tokenize);
+  while (!source.is_finished()) {
+    auto out = parser.parse(source);
+    if (!out) {
+      std::cerr << "can't parse the corpus" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    source.advance(std::distance(source.begin(), out->processed_to));
+  }
+  bench::do_not_optimize(parser.get_all_code_fragments().size());
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t max_classes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+
+  // the tokens skip the blanks and select the rules of every statement
+  corpus::Parameters p;
+  p.headers = 1;
+  for (std::size_t classes = 16; classes <= max_classes; classes *= 4) {
+    p.classes_per_file = classes;
+    auto content =
+        std::make_shared<const std::string>(corpus::generate_header(0, p));
+    auto name = "header of " + std::to_string(classes) + " classes";
+
+    auto tokenized = bench::measure([&] { parse(content, true); });
+    bench::report(name + " tokenized", content->size(), tokenized);
+
+    auto plain = bench::measure([&] { parse(content, false); });
+    bench::report(name, content->size(), plain);
+  }
+
+  return 0;
+}
@@ -0,0 +1,231 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Generates trees of headers and sources made of the constructs the parsers
+ * understand, to measure how the preprocessor scales with their size and shape
+ *
+ * Every source defines the meta class value_type, the same one as
+ * bench/meta_classes.cpp, so its classes can be generated by bench_meta
+ */
+namespace corpus {
+
+struct Parameters {
+  std::size_t headers = 4;
+  std::size_t sources = 1;
+  std::size_t classes_per_file = 8;
+  std::size_t members_per_class = 4;
+  // the scopes nested in the functions of the classes
+  std::size_t nesting_depth = 1;
+  // the classes of every source declared with the meta class value_type
+  std::size_t meta_classes_per_file = 1;
+  // the headers included by every header, they form a tree under h0 which
+  // every source includes
+  std::size_t include_fan_out = 2;
+};
+
+struct File {
+  // relative to the root of the tree
+  std::string path;
+  std::string content;
+};
+
+inline std::string header_name(std::size_t i) {
+  return "h" + std::to_string(i) + ".hpp";
+}
+
+inline std::string generate_members(Parameters const& p) {
+  std::string members;
+  for (std::size_t i = 0; i < p.members_per_class; ++i) {
+    auto n = std::to_string(i);
+    members += i % 2 == 0 ? "  int m" + n + " = " + n + ";\n"
+                          : "  std::vector<std::string> m" + n + ";\n";
+  }
+  return members;
+}
+
+/**
+ * A class with its members, a constructor and functions whose bodies nest
+ * nesting_depth scopes
+ */
+inline std::string generate_class(std::string const& name,
+                                  std::string const& base,
+                                  Parameters const& p) {
+  std::string body = "a += b;";
+  for (std::size_t i = 0; i < p.nesting_depth; ++i) {
+    auto n = std::to_string(i);
+    body = "if (b > " + n + ") { for (int i" + n + " = 0; i" + n + " < b; ++i" +
+           n + ") { " + body + " } }";
+  }
+
+  return "struct " + name + " : public " + base +
+         "<std::vector<int>> {\n"
+         "  int a;\n" +
+         generate_members(p) + "  " + name +
+         "(int a) : a{a} {}\n"
+         "  virtual int get_area() const override { return a * a; }\n"
+         "  std::map<std::string, std::vector<int>> const& get(int const x, "
+         "std::string&& y) const noexcept;\n"
+         "  void foo(int b) { " +
+         body +
+         " }\n"
+         "};\n";
+}
+
+/**
+ * The base template of the classes, then the classes and their enums, their
+ * names start with the name of the file
+ *
+ * NOTE: they are global, the reflection of a class in a namespace is generated
+ * inside the namespace where it doesn't compile. The base has one template
+ * argument, the reflection of a base writes its arguments without commas
+ */
+inline std::string generate_classes(std::string const& file,
+                                    Parameters const& p) {
+  auto base = file + "_Base";
+  std::string out = "template <class T>\nstruct " + base +
+                    " {\n  virtual int get_area() const { return 0; }\n};\n";
+  for (std::size_t i = 0; i < p.classes_per_file; ++i) {
+    auto n = std::to_string(i);
+    out += "// class " + n + " of " + file + "\n";
+    out += generate_class(file + "_S" + n, base, p);
+    out += "enum class " + file + "_E" + n + " { A, B, C };\n";
+  }
+  return out;
+}
+
+inline std::string generate_includes(std::size_t first, std::size_t count,
+                                     Parameters const& p) {
+  std::string out = "#include <map>\n#include <string>\n#include <vector>\n";
+  for (auto i = first; i < std::min(first + count, p.headers); ++i) {
+    out += "#include <" + header_name(i) + ">\n";
+  }
+  return out;
+}
+
+/**
+ * The i-th header includes its children in the tree of headers
+ *
+ * NOTE: the parsers don't understand include guards, every header is included
+ * once
+ */
+inline std::string generate_header(std::size_t i, Parameters const& p) {
+  return generate_includes(i * p.include_fan_out + 1, p.include_fan_out, p) +
+         "\n" + generate_classes("h" + std::to_string(i), p);
+}
+
+/**
+ * The meta class value_type, a copy of bench/meta_classes.cpp
+ */
+inline std::string meta_class_definition() {
+  return "constexpr void value_type(meta::type target, const meta::type "
+         "source) {\n"
+         "  for (auto m : source.members_and_bases()) {\n"
+         "    ->(target) m;\n"
+         "  }\n"
+         "};\n";
+}
+
+/**
+ * A source with the meta class and its uses, classes of its own and a
+ * reflexpr of every one of them
+ */
+inline std::string generate_source(std::size_t j, Parameters const& p) {
+  auto file = "s" + std::to_string(j);
+  std::string out = generate_includes(0, 1, p) + "#include <reflect.hpp>\n\n" +
+                    meta_class_definition() + "\n";
+
+  for (std::size_t i = 0; i < p.meta_classes_per_file; ++i) {
+    auto n = std::to_string(i);
+    out += "value_type Value" + n + " {\n" + generate_members(p) + "};\n";
+  }
+
+  out += generate_classes(file, p);
+
+  out += "\ntemplate <class T>\nconstexpr std::size_t count_members() {\n"
+         "  using meta = reflexpr(T);\n"
+         "  return reflect::get_size_v<reflect::get_data_members_t<meta>>;\n"
+         "}\n\nstd::size_t " +
+         file + "_members() {\n  std::size_t members = 0;\n";
+  for (std::size_t i = 0; i < p.classes_per_file; ++i) {
+    out += "  members += count_members<" + file + "_S" + std::to_string(i) +
+           ">();\n";
+  }
+  out += "  return members;\n}\n";
+
+  // the first source runs the others
+  if (j == 0) {
+    for (std::size_t k = 1; k < p.sources; ++k) {
+      out += "std::size_t s" + std::to_string(k) + "_members();\n";
+    }
+    out += "\nint main() {\n  std::size_t members = 0;\n";
+    for (std::size_t k = 0; k < p.sources; ++k) {
+      out += "  members += s" + std::to_string(k) + "_members();\n";
+    }
+    out += "  return members == 0;\n}\n";
+  }
+
+  return out;
+}
+
+/**
+ * The headers in include/ and the sources in src/
+ */
+inline std::vector<File> generate(Parameters const& p) {
+  std::vector<File> files;
+  for (std::size_t i = 0; i < p.headers; ++i) {
+    files.push_back({"include/" + header_name(i), generate_header(i, p)});
+  }
+  for (std::size_t j = 0; j < p.sources; ++j) {
+    files.push_back(
+        {"src/s" + std::to_string(j) + ".cpp", generate_source(j, p)});
+  }
+  return files;
+}
+
+/**
+ * A project like the examples building an executable of all the sources,
+ * preprocessed by the preprocessor at preprocessor_dir
+ */
+inline std::string generate_cmake(Parameters const& p,
+                                  std::string const& preprocessor_dir) {
+  std::string out =
+      "cmake_minimum_required(VERSION 3.0.0)\n\n"
+      "set(CMAKE_CXX_STANDARD 17)\nproject(corpus)\n\n"
+      "set(preprocessor_dir \"" +
+      preprocessor_dir +
+      "\")\n"
+      "add_subdirectory(${preprocessor_dir} ./preprocessor_build "
+      "EXCLUDE_FROM_ALL)\n\n"
+      "add_executable(corpus";
+  for (std::size_t j = 0; j < p.sources; ++j) {
+    out += " src/s" + std::to_string(j) + ".cpp";
+  }
+  out += ")\ntarget_include_directories(corpus PUBLIC "
+         "${PROJECT_SOURCE_DIR}/include)\n"
+         "preprocess(corpus ${preprocessor_dir})\n";
+  return out;
+}
+
+/**
+ * Write the files under root
+ */
+inline void write(std::filesystem::path const& root,
+                  std::vector<File> const& files) {
+  for (auto& file : files) {
+    auto path = root / file.path;
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::out | std::ios::binary) << file.content;
+  }
+}
+
+}  // namespace corpus
+
+#endif  //! CORPUS_H
@@ -0,0 +1,57 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "corpus.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * Write a corpus project to the out dir, built like the examples with the
+ * preprocessor at preprocessor_dir
+ */
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " out_dir preprocessor_dir [--headers n] [--sources n]"
+                 " [--classes n] [--members n] [--depth n] [--meta n]"
+                 " [--fan-out n]"
+              << std::endl;
+    return 2;
+  }
+
+  corpus::Parameters p;
+  for (int i = 3; i + 1 < argc; i += 2) {
+    std::string_view arg = argv[i];
+    std::size_t value = std::strtoul(argv[i + 1], nullptr, 10);
+    if (arg == "--headers") {
+      p.headers = value;
+    } else if (arg == "--sources") {
+      p.sources = value;
+    } else if (arg == "--classes") {
+      p.classes_per_file = value;
+    } else if (arg == "--members") {
+      p.members_per_class = value;
+    } else if (arg == "--depth") {
+      p.nesting_depth = value;
+    } else if (arg == "--meta") {
+      p.meta_classes_per_file = value;
+    } else if (arg == "--fan-out") {
+      p.include_fan_out = value;
+    } else {
+      std::cerr << "unknown parameter " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  fs::path out = argv[1];
+  corpus::write(out, corpus::generate(p));
+  std::ofstream(out / "CMakeLists.txt")
+      << corpus::generate_cmake(p, fs::absolute(argv[2]).string());
+
+  std::cout << "corpus written to " << out << std::endl;
+  return 0;
+}
@@ -0,0 +1,8 @@
+#include <string>
+
+// a meta class that copies the members, the cost is mostly the round trip
+constexpr void value_type(meta::type target, const meta::type source) {
+  for (auto m : source.members_and_bases()) {
+    ->(target) m;
+  }
+};
@@ -2,6 +2,7 @@
 #define GEN_UTILS_H
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <iterator>
 
@@ -9,10 +10,12 @@
 #include <std_helpers.hpp>
 
 #include <meta_classes_rules.hpp>
-#include <meta_process.hpp>
+#include <meta_include/meta_wire.hpp>
 
 namespace helper = std_parser::rules::ast;
 namespace meta_classes {
+namespace wire = meta::wire;
+
 // TODO: replace with a range when we have them
 template <class Iter>
 auto gen_target_output(rules::ast::Target& t, Iter begin, Iter end) {
@@ -76,141 +79,165 @@ std::string gen_main(Container& meta_classes) {
   out += "};";
 
   out += R"main(
+/**
+ * Handle one message from the preprocessor, returns false on Exit
+ */
+static bool handle_message(std::string_view frame) {
+  namespace wire = meta::wire;
+  auto& channel = meta::detail::channel;
+
+  wire::Reader in{frame};
+  switch (in.message()) {
+    case wire::Message::Hello: {
+      wire::Writer out{wire::Message::Hello};
+      out.pod(wire::magic).pod(wire::version);
+      channel.send(out);
+      break;
+    }
+    case wire::Message::ListMetaClasses: {
+      wire::Writer out{wire::Message::MetaClasses};
+      out.pod(static_cast<std::uint32_t>(funs.size()));
+      for (auto& kv : funs) {
+        out.str(kv.first);
+      }
+      channel.send(out);
+      break;
+    }
+    case wire::Message::Generate: {
+      channel.request = in.pod<std::uint32_t>();
+      std::string fun{in.str()};
+      std::string output;
+      {
+        auto const type = meta::read_type(in);
+        meta::type t{type.name()};
+        auto f = funs.at(fun);
+        f(t, type);
+        output = t.get_representation();
+      }
+      wire::Writer out{wire::Message::Generated};
+      out.pod(channel.request).str(output);
+      channel.send(out);
+      break;
+    }
+    case wire::Message::Exit:
+      return false;
+    default:
+      compiler.error("unknown message");
+  }
+
+  return true;
+}
+
+#ifdef ZERO_PREPROCESSOR_META_LIBRARY
 #ifdef _WIN32
-#include <fcntl.h>
-#include <io.h>
+#define META_EXPORT extern "C" __declspec(dllexport)
+#else
+#define META_EXPORT extern "C" __attribute__((visibility("default")))
 #endif
+
+META_EXPORT std::uint32_t zero_meta_version() { return meta::wire::version; }
+
+META_EXPORT int zero_meta_handle(const char* payload, std::uint32_t size,
+                                 meta::wire::Callback send, void* context) {
+  return meta::detail::handle_in_process(payload, size, send, context,
+                                         handle_message);
+}
+#else
 int main(int argc, char* argv[]) {
-#ifdef _WIN32
-  _setmode( _fileno( stdout ),  _O_BINARY );
-#endif
-  int mode;
-  while (true) {
-    std::cin >> mode;
-    switch (mode) {
-      case 1: {
-        std::cout << funs.size() << std::endl;
-        for (auto& kv : funs) {
-          std::cout << kv.first << '\n';
-        }
-        break;
-      }
-      case 2: {
-        std::string fun;
-        std::cin >> fun;
-        std::string output;
-        {
-          auto const type = meta::read_type();
-          meta::type t{type.name()};
-          auto f = funs.at(fun);
-          f(t, type);
-          output = t.get_representation();
-        }
-        std::cout << 0 << '\n';
-        std::cout << output.size() << '\n';
-        std::cout << output << std::endl;
-        break;
-      }
-      case 3:
-        return 0;
-      default:
-        std::cout << "unknown mode " << mode;
+  meta::wire::set_binary_stdio();
+
+  std::string frame;
+  while (meta::detail::channel.next(frame)) {
+    if (!handle_message(frame)) {
+      return 0;
     }
   }
 
   return 0;
 }
+#endif
 )main";
   return out;
 }
 
-template <typename Writer>
 void write_location(std_parser::rules::ast::SourceLocation const& loc,
-                    Writer& writer) {
-  writer << loc.row << '\n';
-  writer << loc.col << '\n';
+                    wire::Writer& writer) {
+  writer.pod(static_cast<std::uint16_t>(loc.row));
+  writer.pod(static_cast<std::uint16_t>(loc.col));
+}
+
+void write_qualifiers(
+    std::vector<std_parser::rules::ast::TypeQualifier> const& qualifiers,
+    wire::Writer& writer) {
+  writer.pod(static_cast<std::uint32_t>(qualifiers.size()));
+  for (auto q : qualifiers) {
+    writer.enumeration(q);
+  }
 }
 
-template <typename Writer>
-void write_type(std_parser::rules::ast::Type const& type, Writer& writer) {
-  helper::serialize(writer, type);
+void write_type(std_parser::rules::ast::Type const& type,
+                wire::Writer& writer) {
+  write_qualifiers(type.left_qualifiers, writer);
+  writer.str(helper::to_string(type.type));
+  write_qualifiers(type.right_qualifiers, writer);
 }
 
 using AccessModifier = std_parser::rules::ast::access_modifier;
-template <typename Writer>
 void write_function(std_parser::rules::ast::Function const& fun,
-                    AccessModifier modifier, Writer& writer) {
+                    AccessModifier modifier, wire::Writer& writer) {
   write_location(fun.loc, writer);
   write_type(fun.return_type, writer);
-
-  writer << fun.is_virtual << '\n';
-
-  writer << static_cast<int>(fun.constructor_type) << '\n';
-
-  writer << static_cast<int>(modifier) << '\n';
-
-  writer << fun.name << '\n';
+  writer.boolean(fun.is_virtual);
+  writer.enumeration(fun.constructor_type);
+  writer.enumeration(modifier);
+  writer.str(fun.name);
 
   auto& params = fun.parameters.parameters;
-  writer << params.size() << '\n';
-
+  writer.pod(static_cast<std::uint32_t>(params.size()));
   for (auto& p : params) {
     write_type(p.type, writer);
-    writer << p.name << '\n';
+    writer.str(p.name);
   }
 
-  writer << fun.is_const << '\n';
-
-  writer << static_cast<int>(fun.qualifier) << '\n';
-
-  writer << fun.is_noexcept << '\n';
-
-  writer << fun.is_override << '\n';
-
-  writer << fun.is_pure_virtual << '\n';
-
-  writer << fun.body.size() << '\n';
-
-  if (!fun.body.empty()) {
-    writer << fun.body << '\n';
-  }
+  writer.boolean(fun.is_const);
+  writer.enumeration(fun.qualifier);
+  writer.boolean(fun.is_noexcept);
+  writer.boolean(fun.is_override);
+  writer.boolean(fun.is_pure_virtual);
+  writer.str(fun.body);
 }
 
-template <typename Writer>
 void write_methods(std::vector<std_parser::rules::ast::Function> const& methods,
-                   AccessModifier modifier, Writer& writer) {
+                   AccessModifier modifier, wire::Writer& writer) {
   for (auto& m : methods) {
     write_function(m, modifier, writer);
   }
 }
 
-template <typename Writer>
 void write_variables(std::vector<std_parser::rules::ast::var> const& variables,
-                     AccessModifier modifier, Writer& writer) {
+                     AccessModifier modifier, wire::Writer& writer) {
   for (auto& v : variables) {
     write_location(v.loc, writer);
     write_type(v.type, writer);
-    writer << static_cast<int>(modifier);
-    writer << v.name << std::endl;
+    writer.enumeration(modifier);
+    writer.str(v.name);
   }
 }
 
-template <typename Writer>
 void write_bases(
     std::vector<std_parser::rules::ast::UnqulifiedType> const& bases,
-    AccessModifier modifier, Writer& writer) {
+    AccessModifier modifier, wire::Writer& writer) {
   for (auto& b : bases) {
-    writer << helper::to_string(b) << std::endl;
-    writer << static_cast<int>(modifier) << std::endl;
+    writer.str(helper::to_string(b));
+    writer.enumeration(modifier);
   }
 }
 
-template <typename Writer>
-void write_class(std_parser::rules::ast::Class& cls, Writer& writer) {
-  writer << cls.name << std::endl;
-  writer << (cls.public_methods.size() + cls.private_methods.size() +
-             cls.protected_methods.size() + cls.unspecified_methods.size())
-         << std::endl;
+void write_class(std_parser::rules::ast::Class& cls, wire::Writer& writer) {
+  writer.str(cls.name);
+  writer.pod(static_cast<std::uint32_t>(
+      cls.public_methods.size() + cls.private_methods.size() +
+      cls.protected_methods.size() + cls.unspecified_methods.size()));
 
   write_methods(cls.public_methods, AccessModifier::PUBLIC, writer);
 
@@ -220,84 +247,49 @@ void write_class(std_parser::rules::ast::Class& cls, Writer& writer) {
 
   write_methods(cls.unspecified_methods, AccessModifier::UNSPECIFIED, writer);
 
-  writer << (cls.public_members.size() + cls.private_members.size() +
-             cls.protected_members.size() + cls.unspecified_members.size())
-         << std::endl;
+  writer.pod(static_cast<std::uint32_t>(
+      cls.public_members.size() + cls.private_members.size() +
+      cls.protected_members.size() + cls.unspecified_members.size()));
 
   write_variables(cls.public_members, AccessModifier::PUBLIC, writer);
   write_variables(cls.private_members, AccessModifier::PROTECTED, writer);
   write_variables(cls.protected_members, AccessModifier::PRIVATE, writer);
   write_variables(cls.unspecified_members, AccessModifier::UNSPECIFIED, writer);
 
-  writer << (cls.public_bases.size() + cls.private_bases.size() +
-             cls.protected_bases.size())
-         << std::endl;
+  writer.pod(static_cast<std::uint32_t>(cls.public_bases.size() +
+                                        cls.private_bases.size() +
+                                        cls.protected_bases.size()));
 
   write_bases(cls.public_bases, AccessModifier::PUBLIC, writer);
   write_bases(cls.private_bases, AccessModifier::PROTECTED, writer);
   write_bases(cls.protected_bases, AccessModifier::PRIVATE, writer);
 }
 
-enum class ParsedResult { OK, Error };
-
-template <class StdParser, class ErrorReporter>
-void handle_meta_process_request(MetaProcess& process, StdParser& std_parser,
-                                 std::string_view request,
-                                 ErrorReporter& reporter) {
+/**
+ * Parse the class of a parse request from the meta code
+ *
+ * Returns the ParsedClass reply, or the ParseError reply with the message in
+ * error
+ */
+template <class StdParser>
+wire::Writer parse_class_reply(StdParser& std_parser, std::uint32_t id,
+                               std::string_view request, std::string& error) {
   auto out = std_parser.try_parse_entire_class(request.begin(), request.end());
   if (out.result) {
-    process.output << static_cast<int>(ParsedResult::OK) << std::endl;
-    write_class(*out.result, process.output);
-  } else {
-    process.output << static_cast<int>(ParsedResult::Error) << std::endl;
-    std::string msg = "can't parse: \n";
-    std::size_t remaining = std::distance(out.processed_to, request.end());
-    std::size_t size = std::min<std::size_t>(30ul, remaining);
-    msg += std::string_view{&*out.processed_to, size};
-    reporter(msg);
-
-    std::exit(EXIT_FAILURE);
+    wire::Writer writer{wire::Message::ParsedClass};
+    writer.pod(id);
+    write_class(*out.result, writer);
+    return writer;
   }
-}
 
-template <typename StdParser, class ErrorReporter>
-std::string gen_meta_class(MetaProcess& process,
-                           const std::string_view meta_class,
-                           std_parser::rules::ast::Class& cls,
-                           StdParser& std_parser, ErrorReporter& reporter) {
-  std::cout << "getting output from meta process for metaclass " << meta_class
-            << "\n";
-  // TODO: add an enum for meta process request type
-  process.output << 2 << std::endl;
-  process.output << meta_class << std::endl;
-
-  write_class(cls, process.output);
-
-  std::string output, line;
-  int status;
-  std::size_t output_size;
-
-  do {
-    output.clear();
-    process.input >> status;
-    process.input >> output_size;
-    process.input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    output.resize(output_size);
-    process.input.read(output.data(), output_size);
-
-    switch (status) {
-      case -1: {
-        reporter(output);
-        // TODO: throw exception and catch in main to guarantee resource cleanup
-        std::exit(EXIT_FAILURE);
-      }
-      case 1: {
-        handle_meta_process_request(process, std_parser, output, reporter);
-      }
-    }
-  } while (status != 0);
+  error = "can't parse: \n";
+  std::size_t remaining = std::distance(out.processed_to, request.end());
+  std::size_t size = std::min<std::size_t>(30ul, remaining);
+  error += std::string_view{&*out.processed_to, size};
 
-  return output;
+  wire::Writer writer{wire::Message::ParseError};
+  writer.pod(id);
+  return writer;
 }
 }  // namespace meta_classes
 
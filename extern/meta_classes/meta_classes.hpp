@@ -2,8 +2,11 @@
 #define META_CLASSES_H
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <string>
 #include <unordered_set>
 #include <variant>
 
@@ -15,7 +18,7 @@
 
 #include <gen_utils.hpp>
 #include <meta_classes_rules.hpp>
-#include <meta_process.hpp>
+#include <meta_process_pool.hpp>
 
 #include <boost/process.hpp>
 
@@ -39,11 +42,9 @@ class MetaClassParser {
     std::string res;
     if (out) {
       // if inside a constexpr function add it as a meta function
-      const auto& current_code_fragment =
-          std_parser.get_current_code_fragment();
       using Fun = std_parser::rules::ast::Function;
-      if (std::holds_alternative<Fun>(current_code_fragment)) {
-        const Fun& fun = std::get<Fun>(current_code_fragment);
+      if (std_parser.template is_current_code_fragment<Fun>()) {
+        const Fun& fun = std_parser.template get_current_code_fragment<Fun>();
         meta_classes.emplace(fun.name);
         inside_meta_class_function = true;
         res = {out->result.begin(), out->result.end()};
@@ -61,8 +62,8 @@ class MetaClassParser {
 
   bool is_meta_param(std_ast::var const& var) {
     // TODO: check for aliases when we can
-    auto const& type_name = var.type.type.name;
-    return type_name == std::vector<std::string>{"meta", "type"};
+    static const std_ast::Type_ meta_type{"meta", "type"};
+    return var.type.type.name == meta_type;
   }
 
   bool is_only_const(std_ast::var const& var) {
@@ -238,10 +239,10 @@ class MetaClassParser {
     using Fun = std_parser::rules::ast::Function;
 
     return std::any_of(code_fragments.begin(), code_fragments.end(),
-                       [this](auto& code_fragment) {
+                       [this](auto code_fragment) {
                          // TODO: when parsing a constexpr meta function save
                          // it's name and check it here
-                         return std::holds_alternative<Fun>(code_fragment);
+                         return code_fragment.template is<Fun>();
                        });
   }
 
@@ -272,11 +273,12 @@ class MetaClassParser {
 
     return std::any_of(
         code_fragments.begin(), code_fragments.end(),
-        [this](auto& code_fragment) {
-          if (!std::holds_alternative<Class>(code_fragment)) {
+        [this, &std_parser](auto code_fragment) {
+          if (!code_fragment.template is<Class>()) {
             return false;
           }
-          auto class_code_fragment = std::get<Class>(code_fragment);
+          auto& class_code_fragment =
+              std_parser.template get_code_fragment<Class>(code_fragment);
           return class_code_fragment.name == current_meta_class_name;
         });
   }
@@ -290,28 +292,31 @@ class MetaClassParser {
     namespace x3 = boost::spirit::x3;
     bool parsed = x3::parse(begin, end, rules::scope_end);
 
-    std::string output;
     using Class = std_parser::rules::ast::Class;
     // TODO: check if this will get triggered if a method ends with };
-    if (parsed && meta_process.ok()) {
-      auto& current_code_fragment = std_parser.get_current_code_fragment();
-      auto& cls = std::get<Class>(current_code_fragment);
-      auto& reporter = parent.get_reporter();
-      auto const& file_name = parent.get_current_file_name();
-      auto error_reporter = [&reporter, &file_name](std::string_view msg) {
-        reporter(file_name, msg);
-      };
-      output = gen_meta_class(meta_process, current_meta_class, cls, std_parser,
-                              error_reporter);
+    // NOTE: the class is closed by the std parser, so keep it for the meta
+    // process in case this is the end of the class
+    std::optional<Class> cls;
+    if (parsed && meta_process && meta_process->ok()) {
+      cls = std_parser.template get_current_code_fragment<Class>();
     }
 
     auto out = std_parser.parse(source);
-    if (out) {
-      if (not is_still_inside_meta_class()) {
-        current_meta_class.clear();
-        current_meta_class_name.clear();
-        return std::optional{Result{out->processed_to, output}};
+    if (out && not is_still_inside_meta_class()) {
+      // the generated class replaces the class, the rest of the source is
+      // parsed while it is generated
+      if (cls) {
+        auto& reporter = parent.get_reporter();
+        auto file_name = parent.get_current_file_name();
+        auto error_reporter = [&reporter, file_name](std::string_view msg) {
+          reporter(file_name, msg);
+        };
+        parent.write_deferred(
+            meta_process->generate(current_meta_class, *cls, error_reporter));
       }
+
+      current_meta_class.clear();
+      current_meta_class_name.clear();
     }
 
     // TODO: if not parsed throw error ?
@@ -325,9 +330,11 @@ class MetaClassParser {
   bool inside_meta_class_function = false;
   std::string current_meta_class;
   std::string current_meta_class_name;
-  std::ofstream out_file;
+  source::OutputSink out_file;
   source::SourceLoader source_loader;
-  MetaProcess meta_process;
+  // the pool of the meta processes, owned_meta_process if not shared
+  MetaProcessPool* meta_process = nullptr;
+  std::unique_ptr<MetaProcessPool> owned_meta_process;
   bool is_source = false;
 
  public:
@@ -338,32 +345,27 @@ class MetaClassParser {
                   std::string_view meta_out)
       : parent{p}, meta_exe{meta_exe}, source_loader{{}, meta_out} {
     if (!this->meta_exe.empty()) {
-      meta_process = MetaProcess(this->meta_exe);
-      bp::opstream& p1 = meta_process.output;
-      bp::ipstream& p2 = meta_process.input;
-      p1 << '1' << std::endl;
-      std::string out;
-      int n;
-      p2 >> n;
-      while (n-- && p2 >> out) {
-        meta_classes.emplace(std::move(out));
-      }
+      owned_meta_process =
+          std::make_unique<MetaProcessPool>(this->meta_exe, 1);
+      meta_process = owned_meta_process.get();
+      meta_classes = meta_process->get_meta_classes();
     }
   }
 
-  MetaClassParser(MetaClassParser&&) = default;
-
-  ~MetaClassParser() noexcept {
-    if (!this->meta_exe.empty()) {
-      meta_process.output << 3 << std::endl;
-      meta_process.wait();
-    }
-  }
+  /**
+   * Use the meta processes of the pool, it can be shared with other parsers
+   * and has to outlive this one
+   */
+  MetaClassParser(Parent& p, MetaProcessPool& pool, std::string_view meta_out)
+      : parent{p},
+        meta_classes{pool.get_meta_classes()},
+        source_loader{{}, meta_out},
+        meta_process{&pool} {}
 
   void start_preprocess(std::string_view source_name) {
     std::cout << "preprocess " << source_name << std::endl;
     out_file = source_loader.open_source(source_name);
-    out_file << "#include <meta.hpp>" << std::endl;
+    out_file << "#include <meta.hpp>" << '\n';
     is_source = source::is_source(source_name);
   }
 
@@ -374,10 +376,8 @@ class MetaClassParser {
   template <class Source>
   auto preprocess(Source& source) {
     auto writer = [this](auto& src) {
-      for (auto& elem : src) {
-        out_file << elem;
-      }
-      out_file << '\n';
+      out_file.write(src);
+      out_file.put('\n');
     };
 
     // TODO: fix this
@@ -397,7 +397,9 @@ class MetaClassParser {
     if (is_source) {
       out_file << gen_main(meta_classes);
     }
-    out_file.close();
+    if (!out_file.commit()) {
+      std::cerr << "can't write the preprocessed source" << std::endl;
+    }
   }
 
   /**
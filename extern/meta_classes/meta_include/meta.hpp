@@ -3,6 +3,10 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -11,20 +15,146 @@
 #include <variant>
 #include <vector>
 
+#include "meta_wire.hpp"
+
+namespace meta::detail {
+/**
+ * Thrown by a failure of the meta code running inside the preprocessor, after
+ * the error was sent
+ */
+struct Failure {};
+
+/**
+ * The frames from and to the preprocessor
+ *
+ * The preprocessor doesn't wait for a class to be generated before sending the
+ * next one, so the requests that arrive while waiting for a parse reply are
+ * kept for later
+ *
+ * Inside the preprocessor (see wire::HandleFunction) the frames go through its
+ * callback instead of stdin and stdout
+ */
+struct Channel {
+  std::deque<std::string> queued;
+  // the id of the request being generated
+  std::uint32_t request = 0;
+
+  wire::Callback callback = nullptr;
+  void* context = nullptr;
+
+  bool next(std::string& frame) {
+    if (queued.empty()) {
+      return wire::read_frame(std::cin, frame);
+    }
+
+    frame = std::move(queued.front());
+    queued.pop_front();
+    return true;
+  }
+
+  void send(wire::Writer& writer) {
+    if (callback == nullptr) {
+      writer.send(std::cout);
+      return;
+    }
+
+    auto& frame = writer.data();
+    const char* reply = nullptr;
+    callback(context, frame.data() + sizeof(std::uint32_t),
+             frame.size() - sizeof(std::uint32_t), &reply);
+  }
+
+  /**
+   * Send the parse request and get the reply to it in frame
+   */
+  bool parse(wire::Writer& writer, std::string& frame) {
+    if (callback == nullptr) {
+      writer.send(std::cout);
+      return parse_reply(frame);
+    }
+
+    auto& request = writer.data();
+    const char* reply = nullptr;
+    auto size = callback(context, request.data() + sizeof(std::uint32_t),
+                         request.size() - sizeof(std::uint32_t), &reply);
+    frame.assign(reply, size);
+    return size != 0;
+  }
+
+  /**
+   * Read frames until the reply to the parse request of the current request
+   */
+  bool parse_reply(std::string& frame) {
+    while (wire::read_frame(std::cin, frame)) {
+      wire::Reader in{frame};
+      auto message = in.message();
+      if ((message == wire::Message::ParsedClass ||
+           message == wire::Message::ParseError) &&
+          in.pod<std::uint32_t>() == request) {
+        return true;
+      }
+
+      queued.push_back(std::move(frame));
+    }
+
+    return false;
+  }
+
+  /**
+   * Stop generating, the meta process exits while inside the preprocessor
+   * only the current message is abandoned
+   */
+  [[noreturn]] void fail() {
+    if (callback != nullptr) {
+      throw Failure{};
+    }
+
+    std::exit(EXIT_FAILURE);
+  }
+};
+
+// NOTE: a loaded library is used by all the threads of the preprocessor
+inline thread_local Channel channel;
+
+/**
+ * Handle the message with the handler while called by the preprocessor
+ *
+ * Returns 0 unless an Error was sent
+ */
+template <class Handler>
+int handle_in_process(const char* payload, std::uint32_t size,
+                      wire::Callback send, void* context, Handler handler) {
+  channel.callback = send;
+  channel.context = context;
+
+  int result = 0;
+  try {
+    handler(std::string_view{payload, size});
+  } catch (Failure const&) {
+    result = 1;
+  } catch (std::exception const& e) {
+    wire::Writer error{wire::Message::Error};
+    error.pod(channel.request).str(e.what());
+    channel.send(error);
+    result = 1;
+  }
+
+  channel.callback = nullptr;
+  channel.context = nullptr;
+  return result;
+}
+}  // namespace meta::detail
+
 static struct {
   void require(bool b, std::string_view msg) {
     if (!b) {
-      std::cout << -1 << std::endl;
-      std::cout << msg.size() << std::endl;
-      std::cout << msg << std::endl;
-      std::exit(EXIT_FAILURE);
+      error(msg);
     }
   }
 
   template <class T>
   void require(bool b, std::string_view msg, T& t) {
     if (!b) {
-      std::cout << -1 << std::endl;
       std::string msg_with_loc;
       msg_with_loc += ':';
       auto loc = t.loc;
@@ -33,17 +163,16 @@ static struct {
       msg_with_loc += std::to_string(loc.col);
       msg_with_loc += ": ";
       msg_with_loc += msg;
-      std::cout << msg_with_loc.size() << std::endl;
-      std::cout << msg_with_loc << std::endl;
-      std::exit(EXIT_FAILURE);
+      error(msg_with_loc);
     }
   }
 
-  void error(std::string_view msg) {
-    std::cout << -1 << std::endl;
-    std::cout << msg.size() << std::endl;
-    std::cout << msg << std::endl;
-    std::exit(EXIT_FAILURE);
+  [[noreturn]] void error(std::string_view msg) {
+    auto& channel = meta::detail::channel;
+    meta::wire::Writer error{meta::wire::Message::Error};
+    error.pod(channel.request).str(msg);
+    channel.send(error);
+    channel.fail();
   }
 } compiler;
 
@@ -385,7 +514,7 @@ struct Type {
 void finalize(meta::type& target);
 }  // namespace detail
 
-type read_type();
+type read_type(wire::Reader& in);
 
 class type {
   const std::string class_name;
@@ -402,23 +531,29 @@ class type {
       : class_name{std::move(name)},
         internal{std::make_shared<detail::Type>()} {}
 
-  ~type() {
+  // NOTE: throws detail::Failure if the content can't be parsed inside the
+  // preprocessor
+  ~type() noexcept(false) {
     // NOTE: if there is any generated ( -> ) based content
     // send it for parsing and update our internal state
-    if (!internal->body.empty()) {
-      enum class ParsedResult { OK, Error };
-      std::cout << 1 << std::endl;
-      auto str = to_string();
-      std::cout << str.size() << std::endl;
-      std::cout << str << std::endl;
-      int out;
-      std::cin >> out;
-      auto result = static_cast<ParsedResult>(out);
-      if (result == ParsedResult::Error) {
-        std::exit(EXIT_FAILURE);
+    // nothing is sent while a failure is unwinding
+    if (!internal->body.empty() && std::uncaught_exceptions() == 0) {
+      auto& channel = detail::channel;
+      wire::Writer request{wire::Message::ParseRequest};
+      request.pod(channel.request).str(to_string());
+
+      std::string frame;
+      if (!channel.parse(request, frame)) {
+        channel.fail();
+      }
+
+      wire::Reader in{frame};
+      if (in.message() != wire::Message::ParsedClass) {
+        channel.fail();
       }
+      in.pod<std::uint32_t>();
 
-      type t = read_type();
+      type t = read_type(in);
       *internal = *t.internal;
     }
   }
@@ -518,103 +653,65 @@ class type {
 };
 
 namespace detail {
-SourceLocation read_loc() {
-  uint16_t row, col;
-  std::cin >> row >> col;
+SourceLocation read_loc(wire::Reader& in) {
+  auto row = in.pod<uint16_t>();
+  auto col = in.pod<uint16_t>();
   return {row, col};
 }
 
-CppType read_cpp_type() {
-  std::size_t n;
-  std::cin >> n;
-  std::vector<TypeQualifier> left_qualifiers;
-  while (n-- > 0) {
-    int q;
-    std::cin >> q;
-    left_qualifiers.push_back(static_cast<TypeQualifier>(q));
-  }
-
-  bool empty;
-  std::cin >> empty;
-  std::string type;
-  if (!empty) {
-    std::cin >> type;
+std::vector<TypeQualifier> read_qualifiers(wire::Reader& in) {
+  std::vector<TypeQualifier> qualifiers(in.count());
+  for (auto& q : qualifiers) {
+    q = in.enumeration<TypeQualifier>();
   }
+  return qualifiers;
+}
 
-  std::cin >> n;
-  std::vector<TypeQualifier> right_qualifiers;
-  while (n-- > 0) {
-    int q;
-    std::cin >> q;
-    right_qualifiers.push_back(static_cast<TypeQualifier>(q));
-  }
+CppType read_cpp_type(wire::Reader& in) {
+  auto left_qualifiers = read_qualifiers(in);
+  std::string type{in.str()};
+  auto right_qualifiers = read_qualifiers(in);
 
   return {std::move(left_qualifiers), std::move(type),
           std::move(right_qualifiers)};
 }
 
-Param read_parameter() {
-  std::string name;
-  auto type = read_cpp_type();
-  std::cin >> name;
+Param read_parameter(wire::Reader& in) {
+  auto type = read_cpp_type(in);
+  std::string name{in.str()};
 
   return {std::move(type), std::move(name)};
 }
 
-Var read_var() {
-  auto loc = read_loc();
-  std::string name;
-  auto type = read_cpp_type();
-  int a;
-  std::cin >> a;
-  Access acc = static_cast<Access>(a);
-  std::cin >> name;
+Var read_var(wire::Reader& in) {
+  auto loc = read_loc(in);
+  auto type = read_cpp_type(in);
+  auto acc = in.enumeration<Access>();
+  std::string name{in.str()};
 
   return {std::move(type), std::move(name), acc, loc};
 }
 
-Function read_function() {
-  auto loc = read_loc();
-  auto return_type = read_cpp_type();
-  bool is_virtual;
-  std::cin >> is_virtual;
-  int a;
-  std::cin >> a;
-  Constructor constructor_type = static_cast<Constructor>(a);
-  std::cin >> a;
-  Access acc = static_cast<Access>(a);
+Function read_function(wire::Reader& in) {
+  auto loc = read_loc(in);
+  auto return_type = read_cpp_type(in);
+  bool is_virtual = in.boolean();
+  auto constructor_type = in.enumeration<Constructor>();
+  auto acc = in.enumeration<Access>();
+  std::string name{in.str()};
 
-  std::string name;
-  std::cin >> name;
-  std::size_t num_params;
-  std::cin >> num_params;
-  std::vector<Param> params;
-  params.reserve(num_params);
-  while (num_params-- > 0) {
-    params.emplace_back(read_parameter());
+  // every element starts with a string or holds one, its size is a uint32
+  std::vector<Param> params(in.count(sizeof(std::uint32_t)));
+  for (auto& param : params) {
+    param = read_parameter(in);
   }
-  bool is_const;
-  std::cin >> is_const;
-
-  std::cin >> a;
-  MethodQualifier qualifier = static_cast<MethodQualifier>(a);
 
-  bool is_noexcept;
-  std::cin >> is_noexcept;
-
-  bool is_override;
-  std::cin >> is_override;
-
-  bool is_pure_virtual;
-  std::cin >> is_pure_virtual;
-
-  std::size_t body_size;
-  std::cin >> body_size;
-  std::string body;
-  if (body_size > 0) {
-    body.resize(body_size);
-    std::cin.read(body.data(), body_size);
-  }
+  bool is_const = in.boolean();
+  auto qualifier = in.enumeration<MethodQualifier>();
+  bool is_noexcept = in.boolean();
+  bool is_override = in.boolean();
+  bool is_pure_virtual = in.boolean();
+  std::string body{in.str()};
 
   return {loc,
           std::move(return_type),
@@ -628,17 +725,14 @@ Function read_function() {
           is_override,
           acc,
           is_pure_virtual,
-          body};
+          std::move(body)};
 }
 
-Base read_base() {
-  std::string name;
-  std::cin >> name;
-  int a;
-  std::cin >> a;
-  Access acc = static_cast<Access>(a);
+Base read_base(wire::Reader& in) {
+  std::string name{in.str()};
+  auto acc = in.enumeration<Access>();
 
-  return {name, acc};
+  return {std::move(name), acc};
 }
 
 void finalize(meta::type& target) {
@@ -658,30 +752,22 @@ void finalize(meta::type& target) {
 }
 }  // namespace detail
 
-type read_type() {
-  std::string class_name;
-  std::cin >> class_name;
-  std::size_t num_methods, num_variables, num_bases;
+type read_type(wire::Reader& in) {
+  std::string class_name{in.str()};
 
-  std::cin >> num_methods;
-  std::vector<detail::Function> methods;
-  methods.reserve(num_methods);
-  while (num_methods-- > 0) {
-    methods.emplace_back(detail::read_function());
+  std::vector<detail::Function> methods(in.count(sizeof(std::uint32_t)));
+  for (auto& method : methods) {
+    method = detail::read_function(in);
   }
 
-  std::cin >> num_variables;
-  std::vector<detail::Var> variables;
-  variables.reserve(num_variables);
-  while (num_variables-- > 0) {
-    variables.emplace_back(detail::read_var());
+  std::vector<detail::Var> variables(in.count(sizeof(std::uint32_t)));
+  for (auto& variable : variables) {
+    variable = detail::read_var(in);
   }
 
-  std::cin >> num_bases;
-  std::vector<detail::Base> bases;
-  bases.reserve(num_bases);
-  while (num_bases-- > 0) {
-    bases.emplace_back(detail::read_base());
+  std::vector<detail::Base> bases(in.count(sizeof(std::uint32_t)));
+  for (auto& base : bases) {
+    base = detail::read_base(in);
   }
 
   return {std::move(class_name), std::move(methods), std::move(variables),
@@ -0,0 +1,211 @@
+#ifndef META_WIRE_H
+#define META_WIRE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <cstdio>
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/**
+ * The framed binary protocol between the preprocessor and the meta executable
+ *
+ * Every message is a frame: the payload size as uint32 followed by the payload,
+ * the payload starts with the Message as uint8. Integers are written in native
+ * byte order as both sides run on the same machine, strings as their uint32
+ * size followed by the characters
+ *
+ * The messages of a class generation (Generate, Generated, Error, ParseRequest
+ * and their replies) continue with the uint32 id of the Generate request, so
+ * the preprocessor can send the next request before the previous one is done
+ */
+namespace meta::wire {
+
+inline constexpr std::uint32_t magic = 0x575a504d;  // "MPZW"
+inline constexpr std::uint32_t version = 2;
+
+// larger frames are treated as a broken stream e.g. a process that doesn't
+// speak this protocol
+inline constexpr std::uint32_t max_frame_size = 1u << 30;
+
+enum class Message : std::uint8_t {
+  // both ways, magic and version
+  Hello,
+  // preprocessor to meta
+  ListMetaClasses,
+  Generate,
+  Exit,
+  ParsedClass,
+  ParseError,
+  // meta to preprocessor
+  MetaClasses,
+  Generated,
+  Error,
+  ParseRequest,
+};
+
+/**
+ * A meta class library is loaded into the preprocessor instead of running as a
+ * meta process, the same messages are passed as payloads through functions
+ *
+ * The library exports handle_symbol as a HandleFunction, it handles one message
+ * and sends its messages with the Callback. The reply to a ParseRequest is
+ * returned by the Callback and is valid until its next call
+ *
+ * HandleFunction returns 0 unless an Error was sent
+ */
+using Callback = std::uint32_t (*)(void* context, const char* payload,
+                                   std::uint32_t size, const char** reply);
+using HandleFunction = int (*)(const char* payload, std::uint32_t size,
+                               Callback send, void* context);
+using VersionFunction = std::uint32_t (*)();
+
+inline constexpr const char* handle_symbol = "zero_meta_handle";
+inline constexpr const char* version_symbol = "zero_meta_version";
+
+/**
+ * Builds one frame in memory so it can be sent with a single write and flush
+ */
+class Writer {
+  std::string frame;
+
+ public:
+  explicit Writer(Message message) {
+    frame.reserve(256);
+    frame.resize(sizeof(std::uint32_t));
+    pod(static_cast<std::uint8_t>(message));
+  }
+
+  template <class T>
+  Writer& pod(T value) {
+    frame.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    return *this;
+  }
+
+  Writer& boolean(bool value) { return pod<std::uint8_t>(value); }
+
+  template <class Enum>
+  Writer& enumeration(Enum value) {
+    return pod(static_cast<std::uint8_t>(value));
+  }
+
+  Writer& str(std::string_view value) {
+    pod(static_cast<std::uint32_t>(value.size()));
+    frame.append(value.data(), value.size());
+    return *this;
+  }
+
+  /**
+   * The finished frame, it can be written to the stream as is
+   */
+  std::string const& data() {
+    std::uint32_t size = frame.size() - sizeof(size);
+    std::memcpy(frame.data(), &size, sizeof(size));
+    return frame;
+  }
+
+  void send(std::ostream& out) {
+    auto& finished = data();
+    out.write(finished.data(), finished.size());
+    out.flush();
+  }
+};
+
+/**
+ * Reads the content of a received frame, strings are views into the frame
+ *
+ * Throws runtime_error if the frame is shorter than what is read
+ */
+class Reader {
+  std::string_view frame;
+  std::size_t position = 0;
+
+  void require(std::size_t size) {
+    if (frame.size() - position < size) {
+      throw std::runtime_error("truncated meta message");
+    }
+  }
+
+ public:
+  explicit Reader(std::string_view frame) : frame{frame} {}
+
+  template <class T>
+  T pod() {
+    require(sizeof(T));
+    T value;
+    std::memcpy(&value, frame.data() + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  bool boolean() { return pod<std::uint8_t>() != 0; }
+
+  template <class Enum>
+  Enum enumeration() {
+    return static_cast<Enum>(pod<std::uint8_t>());
+  }
+
+  Message message() { return enumeration<Message>(); }
+
+  /**
+   * The number of elements that follow, read before allocating them
+   *
+   * Throws runtime_error if the rest of the frame can't hold that many
+   * elements of at least element_size bytes
+   */
+  std::uint32_t count(std::size_t element_size = 1) {
+    auto n = pod<std::uint32_t>();
+    if ((frame.size() - position) / element_size < n) {
+      throw std::runtime_error("truncated meta message");
+    }
+    return n;
+  }
+
+  std::string_view str() {
+    auto size = pod<std::uint32_t>();
+    require(size);
+    std::string_view value = frame.substr(position, size);
+    position += size;
+    return value;
+  }
+};
+
+/**
+ * Read the next frame's payload into frame, the buffer is reused between calls
+ *
+ * Returns false if the stream ended or the frame is too large
+ */
+inline bool read_frame(std::istream& in, std::string& frame) {
+  std::uint32_t size;
+  if (!in.read(reinterpret_cast<char*>(&size), sizeof(size)) ||
+      size > max_frame_size) {
+    return false;
+  }
+
+  frame.resize(size);
+  return static_cast<bool>(in.read(frame.data(), size));
+}
+
+/**
+ * Switch stdin and stdout to binary mode on platforms that translate line
+ * endings
+ */
+inline void set_binary_stdio() {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+}  // namespace meta::wire
+
+#endif  //! META_WIRE_H
@@ -0,0 +1,227 @@
+#ifndef META_LIBRARY_H
+#define META_LIBRARY_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <std_ast.hpp>
+#include <std_parser.hpp>
+#include <trace.hpp>
+
+#include <gen_utils.hpp>
+#include <meta_include/meta_wire.hpp>
+
+namespace meta_classes {
+/**
+ * Check if the meta executable is a meta class library built with
+ * ZERO_PREPROCESSOR_META_LIBRARY
+ */
+bool is_meta_library(std::string_view path) {
+  auto extension = std::filesystem::path(path).extension();
+  return extension == ".so" || extension == ".dylib" || extension == ".dll";
+}
+
+/**
+ * The meta class functions loaded into the preprocessor from a shared library
+ *
+ * The classes are generated on the calling thread by passing the messages of
+ * the meta process protocol through functions, so there is no pipe and no
+ * process to manage. compiler.error only abandons the failed class
+ */
+class MetaLibrary {
+  using ErrorReporter = std::function<void(std::string_view)>;
+
+  /**
+   * The state of one call into the library, the context of its callback
+   */
+  struct Call {
+    ErrorReporter* reporter = nullptr;
+    std::unordered_set<std::string>* meta_classes = nullptr;
+    std::optional<std_parser::StdParser> std_parser;
+    std::string output;
+    std::string reply;
+  };
+
+#ifdef _WIN32
+  HMODULE library = nullptr;
+#else
+  void* library = nullptr;
+#endif
+  std::string path;
+  wire::HandleFunction handle = nullptr;
+  std::unordered_set<std::string> meta_classes;
+
+  std::atomic<std::uint32_t> next_id = 0;
+  std::atomic<std::size_t> generated = 0;
+
+  void* symbol(const char* name) {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(GetProcAddress(library, name));
+#else
+    return dlsym(library, name);
+#endif
+  }
+
+  static std::uint32_t receive(void* context, const char* payload,
+                               std::uint32_t size, const char** reply) {
+    auto& call = *static_cast<Call*>(context);
+    wire::Reader in{{payload, size}};
+    switch (in.message()) {
+      case wire::Message::MetaClasses:
+        for (auto n = in.pod<std::uint32_t>(); n > 0; --n) {
+          call.meta_classes->emplace(in.str());
+        }
+        break;
+      case wire::Message::Generated:
+        in.pod<std::uint32_t>();
+        call.output = in.str();
+        break;
+      case wire::Message::Error:
+        in.pod<std::uint32_t>();
+        (*call.reporter)(in.str());
+        break;
+      case wire::Message::ParseRequest: {
+        if (!call.std_parser) {
+          call.std_parser.emplace();
+        }
+
+        auto id = in.pod<std::uint32_t>();
+        std::string error;
+        auto writer = parse_class_reply(*call.std_parser, id, in.str(), error);
+        if (!error.empty()) {
+          (*call.reporter)(error);
+        }
+
+        call.reply = writer.data().substr(sizeof(std::uint32_t));
+        *reply = call.reply.data();
+        return call.reply.size();
+      }
+      default:
+        break;
+    }
+
+    return 0;
+  }
+
+  void close() noexcept {
+    if (library != nullptr) {
+#ifdef _WIN32
+      FreeLibrary(library);
+#else
+      dlclose(library);
+#endif
+      library = nullptr;
+    }
+  }
+
+  /**
+   * Pass the message to the library
+   *
+   * Returns false if the library reported an error
+   */
+  bool call(wire::Writer& writer, Call& call) {
+    auto& frame = writer.data();
+    return handle(frame.data() + sizeof(std::uint32_t),
+                  frame.size() - sizeof(std::uint32_t), &MetaLibrary::receive,
+                  &call) == 0;
+  }
+
+ public:
+  /**
+   * Load the library and list its meta classes
+   *
+   * Throws runtime_error if it can't be loaded or was built for a different
+   * version of the protocol
+   */
+  explicit MetaLibrary(std::string_view path) : path{path} {
+#ifdef _WIN32
+    library = LoadLibraryA(this->path.c_str());
+    if (library == nullptr) {
+      throw std::runtime_error("can't load the meta class library " +
+                               this->path);
+    }
+#else
+    library = dlopen(this->path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (library == nullptr) {
+      throw std::runtime_error("can't load the meta class library " +
+                               this->path + ": " + dlerror());
+    }
+#endif
+
+    auto version =
+        reinterpret_cast<wire::VersionFunction>(symbol(wire::version_symbol));
+    handle = reinterpret_cast<wire::HandleFunction>(symbol(wire::handle_symbol));
+    if (version == nullptr || handle == nullptr || version() != wire::version) {
+      close();
+      throw std::runtime_error(
+          this->path + " uses a different protocol version, rebuild it");
+    }
+
+    ErrorReporter reporter = [](std::string_view msg) {
+      std::cerr << msg << std::endl;
+    };
+    Call list;
+    list.reporter = &reporter;
+    list.meta_classes = &meta_classes;
+    wire::Writer writer{wire::Message::ListMetaClasses};
+    if (!call(writer, list)) {
+      close();
+      throw std::runtime_error("can't list the meta classes of " + this->path);
+    }
+  }
+
+  MetaLibrary(MetaLibrary const&) = delete;
+  MetaLibrary& operator=(MetaLibrary const&) = delete;
+
+  ~MetaLibrary() noexcept { close(); }
+
+  auto const& get_meta_classes() const { return meta_classes; }
+
+  std::size_t get_generated() const { return generated; }
+
+  /**
+   * Generate the class with the meta class on this thread
+   *
+   * Returns the ready generated class, it throws if the meta code reported an
+   * error after calling the reporter with it
+   */
+  std::future<std::string> generate(const std::string_view meta_class,
+                                    std_parser::rules::ast::Class& cls,
+                                    ErrorReporter reporter) {
+    trace::Span traced{"meta", "gen_meta_class", meta_class};
+    wire::Writer writer{wire::Message::Generate};
+    writer.pod(next_id++);
+    writer.str(meta_class);
+    write_class(cls, writer);
+
+    Call generate;
+    generate.reporter = &reporter;
+    std::promise<std::string> output;
+    if (call(writer, generate)) {
+      output.set_value(std::move(generate.output));
+      ++generated;
+    } else {
+      output.set_exception(std::make_exception_ptr(
+          std::runtime_error("meta class generation failed")));
+    }
+
+    return output.get_future();
+  }
+};
+}  // namespace meta_classes
+
+#endif  //! META_LIBRARY_H
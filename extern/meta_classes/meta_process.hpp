@@ -1,6 +1,9 @@
 #ifndef META_PROCESS_H
 #define META_PROCESS_H
 
+#include <string>
+#include <string_view>
+
 #include <boost/process.hpp>
 
 namespace bp = boost::process;
@@ -17,8 +20,10 @@ class MetaProcess {
 
   MetaProcess(std::string_view process_name) {
     if (!process_name.empty()) {
-      this->process = bp::child(process_name.data(), bp::std_out > input,
-                                bp::std_in < output);
+      // the name is the path of the executable, not a command line split on
+      // spaces
+      this->process = bp::child(bp::exe = std::string{process_name},
+                                bp::std_out > input, bp::std_in < output);
     }
   }
 
@@ -33,6 +38,13 @@ class MetaProcess {
 
   bool ok() { return process.running(); }
 
+  void terminate() noexcept {
+    std::error_code e;
+    if (process.running(e)) {
+      process.terminate(e);
+    }
+  }
+
   void wait() noexcept {
     std::error_code e;
     process.wait(e);
@@ -0,0 +1,118 @@
+#ifndef META_PROCESS_POOL_H
+#define META_PROCESS_POOL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <std_ast.hpp>
+
+#include <meta_library.hpp>
+#include <meta_requests.hpp>
+
+namespace meta_classes {
+/**
+ * A number of meta processes running the same meta executable
+ *
+ * Every request goes to the meta process with the fewest requests in flight,
+ * so it can be shared by all the files and threads of a stage
+ *
+ * A meta class library is loaded once instead and used by all the threads
+ */
+class MetaProcessPool {
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::unique_ptr<MetaRequests>> workers;
+  std::unique_ptr<MetaLibrary> library;
+  Clock::time_point started = Clock::now();
+
+ public:
+  /**
+   * Start size meta processes of the meta executable, at least one
+   *
+   * Throws runtime_error if the meta executable can't be used
+   */
+  MetaProcessPool(std::string_view meta_exe, std::size_t size) {
+    if (is_meta_library(meta_exe)) {
+      library = std::make_unique<MetaLibrary>(meta_exe);
+      return;
+    }
+
+    size = std::max<std::size_t>(size, 1);
+    workers.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      workers.push_back(std::make_unique<MetaRequests>(meta_exe));
+    }
+  }
+
+  std::size_t size() const { return library ? 1 : workers.size(); }
+
+  auto const& get_meta_classes() const {
+    return library ? library->get_meta_classes()
+                   : workers.front()->get_meta_classes();
+  }
+
+  bool ok() {
+    return library || std::any_of(workers.begin(), workers.end(),
+                       [](auto& worker) { return worker->ok(); });
+  }
+
+  /**
+   * Send the class to the least busy meta process to be generated by the meta
+   * class, see MetaRequests::generate
+   */
+  template <class ErrorReporter>
+  std::future<std::string> generate(const std::string_view meta_class,
+                                    std_parser::rules::ast::Class& cls,
+                                    ErrorReporter reporter) {
+    if (library) {
+      return library->generate(meta_class, cls, std::move(reporter));
+    }
+
+    auto worker = workers.begin();
+    auto fewest = (*worker)->in_flight();
+    for (auto it = std::next(worker); it != workers.end() && fewest != 0;
+         ++it) {
+      if (auto in_flight = (*it)->in_flight(); in_flight < fewest) {
+        worker = it;
+        fewest = in_flight;
+      }
+    }
+
+    return (*worker)->generate(meta_class, cls, std::move(reporter));
+  }
+
+  /**
+   * Write how many classes every meta process generated and how much of the
+   * time since the pool started it was busy with them
+   */
+  void report_utilization(std::ostream& out) {
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    auto elapsed = std::max(Clock::now() - started, Clock::duration{1});
+    if (library) {
+      out << "meta library: " << library->get_generated() << " classes"
+          << std::endl;
+      return;
+    }
+
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+      auto utilization = workers[i]->utilization();
+      out << "meta process " << i << ": " << utilization.generated
+          << " classes, " << utilization.restarts << " restarts, busy "
+          << duration_cast<milliseconds>(utilization.busy).count() << "ms ("
+          << 100 * utilization.busy / elapsed << "%)\n";
+    }
+    out << std::flush;
+  }
+};
+}  // namespace meta_classes
+
+#endif  //! META_PROCESS_POOL_H
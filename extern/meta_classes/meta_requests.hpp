@@ -0,0 +1,399 @@
+#ifndef META_REQUESTS_H
+#define META_REQUESTS_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <std_ast.hpp>
+#include <std_parser.hpp>
+#include <trace.hpp>
+
+#include <gen_utils.hpp>
+#include <meta_include/meta_wire.hpp>
+#include <meta_process.hpp>
+
+namespace meta_classes {
+/**
+ * The requests to one meta process
+ *
+ * Generate requests are sent without waiting for the previous ones, so the meta
+ * process generates a class while the next part of the source is parsed. A
+ * reader thread receives the replies, matches them with their request by id and
+ * answers the parse requests of the meta process with its own StdParser
+ *
+ * The meta process exits on compiler.error, the failed request's future throws
+ * and the meta process is restarted with the requests it didn't finish
+ *
+ * NOTE: a request can be sent to a meta process that just exited, the host
+ * has to ignore SIGPIPE so the failed write doesn't kill it, main does
+ */
+class MetaRequests {
+  using ErrorReporter = std::function<void(std::string_view)>;
+  using Clock = std::chrono::steady_clock;
+
+  struct Request {
+    std::promise<std::string> output;
+    ErrorReporter reporter;
+    // the Generate frame, sent again if the meta process is restarted
+    std::string frame;
+    std::string meta_class;
+    Clock::time_point sent;
+  };
+
+  std::unique_ptr<MetaProcess> process;
+  std::string exe;
+  std::unordered_set<std::string> meta_classes;
+
+  // only used by the reader thread
+  std_parser::StdParser std_parser;
+
+  // guards everything below, never held while writing to the process as the
+  // reader thread needs it to read the replies that make room in the pipe
+  std::mutex mutex;
+  // ordered by id so they are sent again in order
+  std::map<std::uint32_t, Request> requests;
+  std::uint32_t next_id = 0;
+  // the meta process reported an error and will exit
+  bool failed = false;
+  // Exit was sent, the meta process isn't restarted anymore
+  bool stopping = false;
+
+  std::size_t generated = 0;
+  // also guarded by send_mutex, changed while holding both
+  std::size_t restarts = 0;
+  Clock::duration busy{};
+  Clock::time_point busy_since;
+
+  // guards writing to the process and replacing it, taken after mutex
+  std::mutex send_mutex;
+
+  std::thread reader;
+
+  /**
+   * Check that the meta process speaks the same version of the protocol
+   *
+   * Throws runtime_error if it doesn't
+   */
+  void handshake(MetaProcess& meta) {
+    wire::Writer{wire::Message::Hello}
+        .pod(wire::magic)
+        .pod(wire::version)
+        .send(meta.output);
+
+    std::string frame;
+    if (wire::read_frame(meta.input, frame)) {
+      wire::Reader in{frame};
+      if (in.message() == wire::Message::Hello &&
+          in.pod<std::uint32_t>() == wire::magic &&
+          in.pod<std::uint32_t>() == wire::version) {
+        return;
+      }
+    }
+
+    throw std::runtime_error(exe +
+                             " uses a different protocol version, rebuild it");
+  }
+
+  void list_meta_classes() {
+    wire::Writer{wire::Message::ListMetaClasses}.send(process->output);
+    std::string frame;
+    if (!wire::read_frame(process->input, frame)) {
+      throw std::runtime_error("can't list the meta classes of " + exe);
+    }
+
+    wire::Reader in{frame};
+    if (in.message() == wire::Message::MetaClasses) {
+      for (auto n = in.pod<std::uint32_t>(); n > 0; --n) {
+        meta_classes.emplace(in.str());
+      }
+    }
+  }
+
+  void send(wire::Writer& writer) {
+    std::lock_guard lock{send_mutex};
+    writer.send(process->output);
+  }
+
+  /**
+   * Remove the request from the in flight ones, must hold the mutex
+   */
+  Request take(std::map<std::uint32_t, Request>::iterator it) {
+    auto request = std::move(it->second);
+    if (trace::enabled()) {
+      trace::Trace::global().async("meta", "gen_meta_class", it->first,
+                                   request.sent, Clock::now(),
+                                   request.meta_class);
+    }
+    requests.erase(it);
+    if (requests.empty()) {
+      busy += Clock::now() - busy_since;
+    }
+
+    return request;
+  }
+
+  /**
+   * Fail the request with the message, the reporter gets it first
+   */
+  void fail(std::uint32_t id, std::string_view msg, bool exits = false) {
+    std::lock_guard lock{mutex};
+    failed |= exits;
+    if (auto it = requests.find(id); it != requests.end()) {
+      auto request = take(it);
+      request.reporter(msg);
+      request.output.set_exception(std::make_exception_ptr(
+          std::runtime_error("meta class generation failed")));
+    }
+  }
+
+  void complete(std::uint32_t id, std::string_view output) {
+    std::lock_guard lock{mutex};
+    if (auto it = requests.find(id); it != requests.end()) {
+      take(it).output.set_value(std::string{output});
+      ++generated;
+    }
+  }
+
+  ErrorReporter reporter_of(std::uint32_t id) {
+    std::lock_guard lock{mutex};
+    auto it = requests.find(id);
+    if (it == requests.end()) {
+      return [](std::string_view msg) { std::cerr << msg << std::endl; };
+    }
+
+    return it->second.reporter;
+  }
+
+  void answer_parse_request(std::uint32_t id, std::string_view request) {
+    std::string error;
+    auto reply = parse_class_reply(std_parser, id, request, error);
+    send(reply);
+    if (!error.empty()) {
+      // the meta process exits when it gets the error
+      fail(id, error, true);
+    }
+  }
+
+  /**
+   * Handle one frame from the meta process
+   *
+   * Returns false if the message isn't expected from the meta process
+   */
+  bool handle(std::string_view frame) {
+    wire::Reader in{frame};
+    auto message = in.message();
+    if (message != wire::Message::Generated &&
+        message != wire::Message::Error &&
+        message != wire::Message::ParseRequest) {
+      return false;
+    }
+
+    auto id = in.pod<std::uint32_t>();
+    switch (message) {
+      case wire::Message::Generated:
+        complete(id, in.str());
+        break;
+      case wire::Message::Error:
+        fail(id, in.str(), true);
+        break;
+      default:
+        answer_parse_request(id, in.str());
+        break;
+    }
+
+    return true;
+  }
+
+  /**
+   * Start the meta process again after it exited and send it the requests it
+   * didn't finish, if it wasn't because of an error the first of them is
+   * failed so a request that crashes it isn't sent forever
+   *
+   * Returns false if the meta process is stopped or can't be restarted
+   */
+  bool restart() {
+    std::unique_lock lock{mutex};
+    if (stopping) {
+      return false;
+    }
+
+    if (!failed && !requests.empty()) {
+      auto request = take(requests.begin());
+      request.reporter("the meta process exited unexpectedly");
+      request.output.set_exception(std::make_exception_ptr(
+          std::runtime_error("meta class generation failed")));
+    }
+
+    failed = false;
+    // a write blocked on the full pipe fails once the process is gone, so
+    // send_mutex is released
+    process->terminate();
+    process->wait();
+    std::unique_ptr<MetaProcess> started;
+    try {
+      started = std::make_unique<MetaProcess>(exe);
+      handshake(*started);
+    } catch (...) {
+      while (!requests.empty()) {
+        take(requests.begin()).output.set_exception(std::current_exception());
+      }
+      return false;
+    }
+
+    // the requests generate registered but didn't send yet are sent here
+    std::vector<std::string> frames;
+    for (auto& [id, request] : requests) {
+      frames.push_back(request.frame);
+    }
+
+    std::unique_lock send_lock{send_mutex};
+    process = std::move(started);
+    ++restarts;
+    lock.unlock();
+
+    for (auto& frame : frames) {
+      process->output.write(frame.data(), frame.size());
+    }
+    process->output.flush();
+    return true;
+  }
+
+  void read_replies() {
+    std::string frame;
+    do {
+      try {
+        while (wire::read_frame(process->input, frame)) {
+          if (!handle(frame)) {
+            std::cerr << "unexpected message from the meta process " << exe
+                      << std::endl;
+            break;
+          }
+        }
+      } catch (std::exception const& e) {
+        // a malformed frame, the meta process is restarted like after an
+        // unexpected message
+        std::cerr << "invalid message from the meta process " << exe << ": "
+                  << e.what() << std::endl;
+      }
+    } while (restart());
+  }
+
+ public:
+  /**
+   * Statistics about the use of the meta process
+   */
+  struct Utilization {
+    std::size_t generated;
+    std::size_t restarts;
+    Clock::duration busy;
+  };
+
+  /**
+   * Start the meta process and list its meta classes
+   *
+   * Throws runtime_error if the meta process can't be used
+   */
+  explicit MetaRequests(std::string_view exe)
+      : process{std::make_unique<MetaProcess>(exe)}, exe{exe} {
+    handshake(*process);
+    list_meta_classes();
+    reader = std::thread{[this] { read_replies(); }};
+  }
+
+  MetaRequests(MetaRequests const&) = delete;
+  MetaRequests& operator=(MetaRequests const&) = delete;
+
+  ~MetaRequests() noexcept {
+    {
+      std::lock_guard lock{mutex};
+      stopping = true;
+    }
+    wire::Writer exit{wire::Message::Exit};
+    send(exit);
+    reader.join();
+    process->wait();
+  }
+
+  bool ok() {
+    std::lock_guard lock{mutex};
+    return process->ok();
+  }
+
+  auto const& get_meta_classes() const { return meta_classes; }
+
+  /**
+   * The number of requests sent that aren't done yet
+   */
+  std::size_t in_flight() {
+    std::lock_guard lock{mutex};
+    return requests.size();
+  }
+
+  Utilization utilization() {
+    std::lock_guard lock{mutex};
+    auto total = busy;
+    if (!requests.empty()) {
+      total += Clock::now() - busy_since;
+    }
+
+    return {generated, restarts, total};
+  }
+
+  /**
+   * Send the class to the meta process to be generated by the meta class
+   *
+   * Returns the future generated class, it throws if the meta process reported
+   * an error after calling the reporter with it
+   */
+  std::future<std::string> generate(const std::string_view meta_class,
+                                    std_parser::rules::ast::Class& cls,
+                                    ErrorReporter reporter) {
+    wire::Writer writer{wire::Message::Generate};
+    std::future<std::string> output;
+    std::size_t registered_restarts;
+    {
+      std::lock_guard lock{mutex};
+      auto id = next_id++;
+      writer.pod(id);
+      writer.str(meta_class);
+      write_class(cls, writer);
+
+      if (requests.empty()) {
+        busy_since = Clock::now();
+      }
+
+      auto& request = requests[id];
+      request.reporter = std::move(reporter);
+      request.frame = writer.data();
+      request.meta_class = meta_class;
+      request.sent = Clock::now();
+      output = request.output.get_future();
+      registered_restarts = restarts;
+    }
+
+    // NOTE: blocks while the pipe to the meta process is full, without the
+    // mutex so the reader thread keeps emptying the other pipe
+    trace::Span traced{"meta", "send to the meta process"};
+    std::lock_guard send_lock{send_mutex};
+    // a restart since it was registered already sent it to the new process
+    if (restarts == registered_restarts) {
+      writer.send(process->output);
+    }
+    return output;
+  }
+};
+}  // namespace meta_classes
+
+#endif  //! META_REQUESTS_H
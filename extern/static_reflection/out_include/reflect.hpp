@@ -1,6 +1,9 @@
 #ifndef REFLECT_H
 #define REFLECT_H
 
+#include <array>
+#include <cstddef>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -11,6 +14,17 @@ struct Reflect {};
 
 enum class ObjectType { CLASS, STRUCT, UNION, ENUM };
 
+// the lists of the flat reflections, std::tuple_size and std::tuple_element
+// work on type_list like on a tuple
+template <class... Ts>
+struct type_list {};
+
+template <auto... Vs>
+struct value_list {};
+
+// the layout of a reflection with its members in a value_list and arrays
+struct flat_layout {};
+
 template <class T>
 struct is_public {
   static constexpr bool value = true;
@@ -125,6 +139,51 @@ constexpr auto is_union_v = is_union<T>::value;
 
 // helper for now
 namespace helper {
+#if defined(__has_builtin)
+#if __has_builtin(__type_pack_element)
+#define REFLECT_HAS_TYPE_PACK_ELEMENT
+#endif
+#endif
+
+#ifdef REFLECT_HAS_TYPE_PACK_ELEMENT
+template <std::size_t N, class... Ts>
+using type_at_t = __type_pack_element<N, Ts...>;
+#else
+// the N-th type is found by overload resolution on the indexed bases, there
+// is no recursive instantiation per element
+template <std::size_t N, class T>
+struct indexed {
+  using type = T;
+};
+
+template <class Is, class... Ts>
+struct indexer;
+
+template <std::size_t... Is, class... Ts>
+struct indexer<std::index_sequence<Is...>, Ts...> : indexed<Is, Ts>... {};
+
+template <std::size_t N, class T>
+indexed<N, T> select(indexed<N, T>);
+
+template <std::size_t N, class... Ts>
+using type_at_t = typename decltype(
+    select<N>(indexer<std::index_sequence_for<Ts...>, Ts...>{}))::type;
+#endif
+
+template <class T, class = void>
+struct is_flat : std::false_type {};
+
+template <class T>
+struct is_flat<T, std::enable_if_t<
+                      std::is_same_v<typename T::layout, flat_layout>>>
+    : std::true_type {};
+
+template <class T>
+constexpr bool is_flat_v = is_flat<T>::value;
+
+template <class C, class M>
+M member_type(M C::*);
+
 template <typename T, int N>
 struct PublicMember {
   static constexpr auto pointer = std::get<N>(T::public_data_members);
@@ -153,22 +212,94 @@ template <template <typename, int> class M, typename T, std::size_t... Is>
 struct selector<M, T, std::index_sequence<Is...>> {
   using type = std::tuple<M<T, Is>...>;
 };
+
+template <typename T, std::size_t N, auto Pointer>
+struct FlatDataMember {
+  static constexpr auto pointer = Pointer;
+  using type = decltype(member_type(Pointer));
+  static constexpr auto name = T::data_member_names[N];
+};
+
+template <typename T, std::size_t N>
+struct FlatEnumerator {
+  static constexpr auto constant = T::enumerator_constants[N];
+  using type = T;
+  static constexpr auto name = T::enumerator_names[N];
+};
+
+/**
+ * The first Is data members of a flat reflection
+ */
+template <class T, class Is, class Pointers>
+struct flat_members;
+
+template <class T, std::size_t... Is, auto... Ps>
+struct flat_members<T, std::index_sequence<Is...>, value_list<Ps...>> {
+  using type = type_list<FlatDataMember<
+      T, Is,
+      type_at_t<Is, std::integral_constant<decltype(Ps), Ps>...>::value>...>;
+};
+
+template <class T, bool = is_flat_v<T>>
+struct public_data_members {
+  static constexpr int N = std::tuple_size<decltype(T::public_data_members)>();
+  using type =
+      typename selector<PublicMember, T, std::make_index_sequence<N>>::type;
+};
+
+template <class T>
+struct public_data_members<T, true> {
+  using type = typename flat_members<
+      T, std::make_index_sequence<T::public_data_member_count>,
+      typename T::data_members>::type;
+};
+
+template <class T, bool = is_flat_v<T>>
+struct data_members {
+  static constexpr int N = std::tuple_size<decltype(T::data_members)>();
+  using type =
+      typename selector<DataMember, T, std::make_index_sequence<N>>::type;
+};
+
+template <class T>
+struct data_members<T, true> {
+  using type = typename flat_members<
+      T, std::make_index_sequence<T::data_member_names.size()>,
+      typename T::data_members>::type;
+};
+
+template <class T, class Is>
+struct flat_enumerators;
+
+template <class T, std::size_t... Is>
+struct flat_enumerators<T, std::index_sequence<Is...>> {
+  using type = type_list<FlatEnumerator<T, Is>...>;
+};
+
+template <class T, bool = is_flat_v<T>>
+struct enumerators {
+  static constexpr int N = std::tuple_size<decltype(T::enumerator_names)>();
+  using type =
+      typename selector<Enumerator, T, std::make_index_sequence<N>>::type;
+};
+
+template <class T>
+struct enumerators<T, true> {
+  using type = typename flat_enumerators<
+      T, std::make_index_sequence<T::enumerator_names.size()>>::type;
+};
 }  // namespace helper
 
 // 21.11.4.8 Record operations
 template <class T>
 struct get_public_data_members {
-  static constexpr int N = std::tuple_size<decltype(T::public_data_members)>();
-  using type = typename helper::selector<helper::PublicMember, T,
-                                         std::make_index_sequence<N>>::type;
+  using type = typename helper::public_data_members<T>::type;
 };
 template <class T>
 struct get_accessible_data_members;
 template <class T>
 struct get_data_members {
-  static constexpr int N = std::tuple_size<decltype(T::data_members)>();
-  using type = typename helper::selector<helper::DataMember, T,
-                                         std::make_index_sequence<N>>::type;
+  using type = typename helper::data_members<T>::type;
 };
 template <class T>
 struct get_public_member_types;
@@ -220,9 +351,7 @@ struct is_scoped_enum {
 };
 template <class T>
 struct get_enumerators {
-  static constexpr int N = std::tuple_size<decltype(T::enumerator_names)>();
-  using type = typename helper::selector<helper::Enumerator, T,
-                                         std::make_index_sequence<N>>::type;
+  using type = typename helper::enumerators<T>::type;
 };
 template <class T>
 struct get_underlying_type {
@@ -276,8 +405,108 @@ struct is_inline;
 
 template <class T>
 constexpr auto is_inline_v = is_inline<T>::value;
+
+// Member iteration, not in the proposal
+namespace helper {
+template <class T>
+using members_of_t = get_data_members_t<Reflect<std::decay_t<T>>>;
+
+template <class Members, class Obj, class F, std::size_t... Is>
+constexpr void for_each_member(Obj& obj, F& f,
+                               std::index_sequence<Is...>) {
+  (f(get_name_v<get_element_t<Is, Members>>,
+     obj.*get_pointer<get_element_t<Is, Members>>::value),
+   ...);
+}
+
+template <class Members, class Obj, class F, std::size_t... Is>
+constexpr auto transform_members(Obj& obj, F& f,
+                                 std::index_sequence<Is...>) {
+  return std::make_tuple(
+      f(get_name_v<get_element_t<Is, Members>>,
+        obj.*get_pointer<get_element_t<Is, Members>>::value)...);
+}
+
+// the type all the members are visited as, the common type only if they differ
+// as it decays references
+template <class T, class... Ts>
+struct visit_result {
+  using type = std::conditional_t<(std::is_same_v<T, Ts> && ...), T,
+                                  std::common_type_t<T, Ts...>>;
+};
+
+template <class... Ts>
+using visit_result_t = typename visit_result<Ts...>::type;
+
+template <class Members, class Obj, class F, std::size_t... Is>
+constexpr decltype(auto) visit_member(Obj& obj, std::size_t index, F& f,
+                                      std::index_sequence<Is...>) {
+  using Result = visit_result_t<decltype(
+      f(get_name_v<get_element_t<Is, Members>>,
+        obj.*get_pointer<get_element_t<Is, Members>>::value))...>;
+  // one function per member, the index selects it without a branch each
+  constexpr Result (*visits[])(Obj&, F&) = {[](Obj& o, F& g) -> Result {
+    return g(get_name_v<get_element_t<Is, Members>>,
+             o.*get_pointer<get_element_t<Is, Members>>::value);
+  }...};
+  return visits[index](obj, f);
+}
+}  // namespace helper
+
+/**
+ * Call f(name, member) with every data member of obj in order
+ */
+template <class Obj, class F>
+constexpr void for_each_member(Obj&& obj, F&& f) {
+  using Members = helper::members_of_t<Obj>;
+  helper::for_each_member<Members>(
+      obj, f, std::make_index_sequence<get_size_v<Members>>{});
+}
+
+/**
+ * A tuple of f(name, member) of every data member of obj in order
+ */
+template <class Obj, class F>
+constexpr auto transform_members(Obj&& obj, F&& f) {
+  using Members = helper::members_of_t<Obj>;
+  return helper::transform_members<Members>(
+      obj, f, std::make_index_sequence<get_size_v<Members>>{});
+}
+
+/**
+ * Call f(name, member) with the data member of obj at index
+ *
+ * Returns what f returns if it is the same for all the members, references
+ * included, otherwise their common type, which is never a reference
+ *
+ * Throws out_of_range if obj doesn't have that many data members
+ */
+template <class Obj, class F>
+constexpr decltype(auto) visit_member(Obj&& obj, std::size_t index, F&& f) {
+  using Members = helper::members_of_t<Obj>;
+  constexpr std::size_t size = get_size_v<Members>;
+  if (index >= size) {
+    throw std::out_of_range("reflect::visit_member index out of range");
+  }
+
+  if constexpr (size != 0) {
+    return helper::visit_member<Members>(obj, index, f,
+                                         std::make_index_sequence<size>{});
+  }
+}
 }  // namespace reflect
 
+namespace std {
+template <class... Ts>
+struct tuple_size<reflect::type_list<Ts...>>
+    : integral_constant<size_t, sizeof...(Ts)> {};
+
+template <size_t N, class... Ts>
+struct tuple_element<N, reflect::type_list<Ts...>> {
+  using type = reflect::helper::type_at_t<N, Ts...>;
+};
+}  // namespace std
+
 template <typename T>
 using reflexpr = reflect::Reflect<T>;
 
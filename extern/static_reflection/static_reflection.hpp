@@ -8,6 +8,7 @@
 #include <result.hpp>
 #include <std_ast.hpp>
 #include <std_helpers.hpp>
+#include <trace.hpp>
 
 namespace static_reflection {
 namespace rules {
@@ -32,6 +33,15 @@ BOOST_SPIRIT_DEFINE(optionaly_space, scope_end, reflexpr);
 
 namespace helper = std_parser::rules::ast;
 
+/**
+ * How the generated reflection holds the members of a type
+ *
+ * Tuple: tuples of the member pointers, their names and their types
+ * Flat: a list of the member pointers as template arguments and an array of
+ * their names, lighter to compile for the users of the reflection
+ */
+enum class Layout { Tuple, Flat };
+
 template <class Parent>
 class StaticReflexParser {
   using Class = std_parser::rules::ast::Class;
@@ -43,7 +53,7 @@ class StaticReflexParser {
   /**
    * Append pointer to data members  as &class_name<tmps>::member.name
    */
-  void append_members(std::string& out, std::vector<var> data_members,
+  void append_members(std::string& out, std::vector<var> const& data_members,
                       std::string_view class_name,
                       std::string_view class_templates) {
     for (auto& member : data_members) {
@@ -63,7 +73,7 @@ class StaticReflexParser {
   /**
    * Append data member names  as "member.name"
    */
-  void append_names(std::string& out, std::vector<var> data_members) {
+  void append_names(std::string& out, std::vector<var> const& data_members) {
     for (auto& member : data_members) {
       out += '\"';
       out += member.name;
@@ -79,7 +89,7 @@ class StaticReflexParser {
   /**
    * append types as decltype(std::declval<class_name<temps>().m.name)
    */
-  void append_types(std::string& out, std::vector<var> data_members,
+  void append_types(std::string& out, std::vector<var> const& data_members,
                     std::string_view class_name,
                     std::string_view class_templates) {
     for (auto& m : data_members) {
@@ -97,9 +107,87 @@ class StaticReflexParser {
     }
   }
 
+  /**
+   * Append the members as tuples, all the data members are the public ones
+   * followed by the protected and the private ones
+   */
+  void append_tuple_members(std::string& out, Class const& c,
+                            std::vector<var> const& data_members,
+                            std::string_view class_templates) {
+    out +=
+        "constexpr inline static auto public_data_members = std::make_tuple(";
+    append_members(out, c.public_members, c.name, class_templates);
+    out += ");\n";
+
+    out +=
+        "constexpr inline static auto public_data_member_names = "
+        "std::make_tuple(";
+    append_names(out, c.public_members);
+    out += ");\n";
+
+    out += "using public_data_member_types = std::tuple<";
+    append_types(out, c.public_members, c.name, class_templates);
+    out += ">;\n";
+
+    out += "constexpr inline static auto data_members = std::make_tuple(";
+    append_members(out, data_members, c.name, class_templates);
+    out += ");\n";
+
+    out += "constexpr inline static auto data_member_names = std::make_tuple(";
+    append_names(out, data_members);
+    out += ");\n";
+
+    out += "using data_member_types = std::tuple<";
+    append_types(out, data_members, c.name, class_templates);
+    out += ">;\n";
+  }
+
+  /**
+   * Append the members as a value list of their pointers and an array of
+   * their names, the public ones are the first public_data_member_count
+   */
+  void append_flat_members(std::string& out, Class const& c,
+                           std::vector<var> const& data_members,
+                           std::string_view class_templates) {
+    out += "using layout = reflect::flat_layout;\n";
+
+    out += "using data_members = reflect::value_list<";
+    append_members(out, data_members, c.name, class_templates);
+    out += ">;\n";
+
+    out += "constexpr inline static std::array<const char*, ";
+    out += std::to_string(data_members.size());
+    out += "> data_member_names = {";
+    append_names(out, data_members);
+    out += "};\n";
+
+    out += "constexpr static std::size_t public_data_member_count = ";
+    out += std::to_string(c.public_members.size());
+    out += ";\n";
+  }
+
+  /**
+   * Append the types as a list named name
+   */
+  void append_type_list(std::string& out, std::string_view name,
+                        std::vector<helper::UnqulifiedType> const& types) {
+    out += "using ";
+    out += name;
+    out += layout == Layout::Flat ? " = reflect::type_list<" : " = std::tuple<";
+    for (auto& type : types) {
+      out += helper::to_string(type);
+      out += ',';
+    }
+
+    if (!types.empty()) {
+      out.pop_back();
+    }
+    out += ">;\n";
+  }
+
   // TODO: generate reflection for the current class
-  // TODO: refactor this method extract to shorter ones
   auto generate_reflection(Class& c) {
+    trace::Span traced{"reflect", "generate_reflection", c.name};
     std::string out;
     out.reserve(300);
     out += "\nfriend reflect::Reflect<";
@@ -140,63 +228,24 @@ class StaticReflexParser {
     }
     out += "> {\n";
 
-    out +=
-        "constexpr inline static auto public_data_members = std::make_tuple(";
-    append_members(out, c.public_members, c.name, class_templates);
-    out += ");\n";
-
-    out +=
-        "constexpr inline static auto public_data_member_names = "
-        "std::make_tuple(";
-    append_names(out, c.public_members);
-    out += ");\n";
-
-    out += "using public_data_member_types = std::tuple<";
-    append_types(out, c.public_members, c.name, class_templates);
-    out += ">;\n";
-
-    out += "constexpr inline static auto data_members = std::make_tuple(";
     auto data_members = c.public_members;
     data_members.insert(data_members.end(), c.protected_members.begin(),
                         c.protected_members.end());
     data_members.insert(data_members.end(), c.private_members.begin(),
                         c.private_members.end());
-    append_members(out, data_members, c.name, class_templates);
-    out += ");\n";
-
-    out += "constexpr inline static auto data_member_names = std::make_tuple(";
-    append_names(out, data_members);
-    out += ");\n";
-
-    out += "using data_member_types = std::tuple<";
-    append_types(out, data_members, c.name, class_templates);
-    out += ">;\n";
-
-    out += "using public_base_classes = std::tuple<";
-    for (auto& type : c.public_bases) {
-      out += helper::to_string(type);
-      out += ',';
+    if (layout == Layout::Flat) {
+      append_flat_members(out, c, data_members, class_templates);
+    } else {
+      append_tuple_members(out, c, data_members, class_templates);
     }
 
-    if (!c.public_bases.empty()) {
-      out.pop_back();
-    }
-    out += ">;\n";
+    append_type_list(out, "public_base_classes", c.public_bases);
     auto base_classes = c.public_bases;
     base_classes.insert(base_classes.end(), c.protected_bases.begin(),
                         c.protected_bases.end());
     base_classes.insert(base_classes.end(), c.private_bases.begin(),
                         c.private_bases.end());
-    out += "using base_classes = std::tuple<";
-    for (auto& type : base_classes) {
-      out += helper::to_string(type);
-      out += ',';
-    }
-
-    if (!base_classes.empty()) {
-      out.pop_back();
-    }
-    out += ">;\n";
+    append_type_list(out, "base_classes", base_classes);
 
     out += "constexpr static auto name = \"";
     out += c.name;
@@ -221,6 +270,7 @@ class StaticReflexParser {
   }
 
   auto generate_reflection(Enumeration& c) {
+    trace::Span traced{"reflect", "generate_reflection", c.name};
     std::string out;
     out.reserve(300);
     out += "\n};\n template <> struct reflect::Reflect<";
@@ -231,7 +281,16 @@ class StaticReflexParser {
     out += c.name;
     out += "\";\n";
 
-    out += "constexpr static auto enumerator_names = std::make_tuple(";
+    // the flat layout holds the names and the constants in arrays
+    bool flat = layout == Layout::Flat;
+    auto size = std::to_string(c.enumerators.size());
+    if (flat) {
+      out += "using layout = reflect::flat_layout;\n";
+      out += "constexpr static std::array<const char*, " + size +
+             "> enumerator_names = {";
+    } else {
+      out += "constexpr static auto enumerator_names = std::make_tuple(";
+    }
     for (auto& e : c.enumerators) {
       out += '\"';
       out += e;
@@ -243,9 +302,14 @@ class StaticReflexParser {
       out.pop_back();
     }
 
-    out += ");\n";
+    out += flat ? "};\n" : ");\n";
 
-    out += "constexpr static auto enumerator_constants = std::make_tuple(";
+    if (flat) {
+      out += "constexpr static std::array<" + c.name + ", " + size +
+             "> enumerator_constants = {";
+    } else {
+      out += "constexpr static auto enumerator_constants = std::make_tuple(";
+    }
     for (auto& e : c.enumerators) {
       out += c.name;
       out += "::";
@@ -257,7 +321,7 @@ class StaticReflexParser {
       out.pop_back();
     }
 
-    out += ");\n";
+    out += flat ? "};\n" : ");\n";
 
     out += "static constexpr auto object_type = reflect::ObjectType::ENUM;\n";
 
@@ -282,13 +346,14 @@ class StaticReflexParser {
 
   template <class Type, class V>
   bool is_(V v) {
-    return std::holds_alternative<Type>(v);
+    return v.template is<Type>();
   }
 
   template <class Type>
   auto generate_reflection() {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
-    auto& current_type = std::get<Type>(std_parser.get_current_code_fragment());
+    auto& current_type =
+        std_parser.template get_current_code_fragment<Type>();
     auto rez = generate_reflection(current_type);
     std_parser.template close_code_fragment<Type>();
     return rez;
@@ -340,8 +405,6 @@ class StaticReflexParser {
   template <typename Iter>
   auto process_reflexpr(Iter it) {
     auto& std_parser = parent.template get_parser<Parent::std_parser_id>();
-    auto& current =
-        std::get<Expression>(std_parser.get_current_code_fragment());
     std_parser.open_new_code_fragment(RoundExpression{});
     in_reflexpr = true;
     return std::optional{Result{it, std::string{"reflexpr<"}}};
@@ -357,6 +420,7 @@ class StaticReflexParser {
 
   // DATA members
   Parent& parent;
+  Layout layout;
 
   bool in_reflexpr = false;
 
@@ -364,7 +428,8 @@ class StaticReflexParser {
   // TODO: when supported in std=c++2a change to fixed length string
   constexpr static int id = 5;
 
-  StaticReflexParser(Parent& p) : parent{p} {}
+  StaticReflexParser(Parent& p, Layout layout = Layout::Tuple)
+      : parent{p}, layout{layout} {}
 
   /**
    * A string to prepend to each file's start
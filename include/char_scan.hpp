@@ -0,0 +1,104 @@
+#ifndef CHAR_SCAN_H
+#define CHAR_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHAR_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define CHAR_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * Vectorized helpers to find characters in a contiguous range of chars
+ *
+ * Every function returns last if nothing is found
+ */
+namespace char_scan {
+
+namespace detail {
+
+inline unsigned count_trailing_zeros(std::uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward(&idx, mask);
+  return idx;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+}  // namespace detail
+
+/**
+ * Find the first c in [first, last)
+ */
+inline const char* find(const char* first, const char* last, char c) {
+  // NOTE: memchr is already vectorized by the standard libraries
+  auto found = std::memchr(first, c, last - first);
+  return found != nullptr ? static_cast<const char*>(found) : last;
+}
+
+/**
+ * Find the first a or b in [first, last)
+ */
+inline const char* find_either(const char* first, const char* last, char a,
+                               char b) {
+#ifdef CHAR_SCAN_AVX2
+  auto wide_a = _mm256_set1_epi8(a);
+  auto wide_b = _mm256_set1_epi8(b);
+  for (; last - first >= 32; first += 32) {
+    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+    auto matches = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, wide_a),
+                                   _mm256_cmpeq_epi8(chunk, wide_b));
+    auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(matches));
+    if (mask != 0) {
+      return first + detail::count_trailing_zeros(mask);
+    }
+  }
+#endif
+
+#ifdef CHAR_SCAN_SSE2
+  auto narrow_a = _mm_set1_epi8(a);
+  auto narrow_b = _mm_set1_epi8(b);
+  for (; last - first >= 16; first += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    auto matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, narrow_a),
+                                _mm_cmpeq_epi8(chunk, narrow_b));
+    auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(matches));
+    if (mask != 0) {
+      return first + detail::count_trailing_zeros(mask);
+    }
+  }
+#endif
+
+  for (; first != last; ++first) {
+    if (*first == a || *first == b) {
+      return first;
+    }
+  }
+
+  return last;
+}
+
+/**
+ * Find the first end of line character ('\n' or '\r') in [first, last)
+ */
+inline const char* find_eol(const char* first, const char* last) {
+  return find_either(first, last, '\n', '\r');
+}
+
+}  // namespace char_scan
+
+#endif  //! CHAR_SCAN_H
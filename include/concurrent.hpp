@@ -0,0 +1,103 @@
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace concurrent {
+
+/**
+ * A set split into independently locked shards so threads inserting
+ * different keys rarely contend
+ */
+template <class T, class Hash = std::hash<T>>
+class ShardedSet {
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::unordered_set<T, Hash> items;
+  };
+
+  std::vector<Shard> shards;
+
+ public:
+  explicit ShardedSet(std::size_t number_of_shards = 64)
+      : shards(number_of_shards) {}
+
+  /**
+   * Insert the item
+   *
+   * Returns true if the item wasn't already in the set
+   */
+  bool insert(T const& item) {
+    auto& shard = shards[Hash{}(item) % shards.size()];
+    std::lock_guard lock{shard.mutex};
+    return shard.items.insert(item).second;
+  }
+};
+
+/**
+ * One work queue per worker, a worker takes from the back of its own queue
+ * and steals from the front of the others when its own is empty
+ *
+ * Every item taken by pop needs a matching call to done, the work is finished
+ * once all pushed items are done
+ */
+template <class T>
+class WorkStealingQueues {
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<T> items;
+  };
+
+  std::vector<Queue> queues;
+  std::atomic<std::size_t> pending = 0;
+
+ public:
+  explicit WorkStealingQueues(std::size_t number_of_workers)
+      : queues(number_of_workers) {}
+
+  void push(std::size_t worker, T item) {
+    ++pending;
+    auto& queue = queues[worker];
+    std::lock_guard lock{queue.mutex};
+    queue.items.push_back(std::move(item));
+  }
+
+  std::optional<T> pop(std::size_t worker) {
+    {
+      auto& own = queues[worker];
+      std::lock_guard lock{own.mutex};
+      if (!own.items.empty()) {
+        auto item = std::move(own.items.back());
+        own.items.pop_back();
+        return item;
+      }
+    }
+
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+      auto& victim = queues[(worker + i) % queues.size()];
+      std::lock_guard lock{victim.mutex};
+      if (!victim.items.empty()) {
+        auto item = std::move(victim.items.front());
+        victim.items.pop_front();
+        return item;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  void done() { --pending; }
+
+  bool finished() const { return pending == 0; }
+};
+
+}  // namespace concurrent
+
+#endif  //! CONCURRENT_H
@@ -0,0 +1,35 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace source {
+
+inline constexpr std::uint64_t empty_content_hash = 14695981039346656037ull;
+
+/**
+ * 64 bit FNV-1a hash of the characters in [first, last)
+ *
+ * Pass a previous hash as seed to hash multiple ranges as one
+ */
+template <class Iter>
+std::uint64_t content_hash(Iter first, Iter last,
+                           std::uint64_t seed = empty_content_hash) {
+  constexpr std::uint64_t prime = 1099511628211ull;
+  for (; first != last; ++first) {
+    seed ^= static_cast<unsigned char>(*first);
+    seed *= prime;
+  }
+
+  return seed;
+}
+
+inline std::uint64_t content_hash(std::string_view content,
+                                  std::uint64_t seed = empty_content_hash) {
+  return content_hash(content.begin(), content.end(), seed);
+}
+
+}  // namespace source
+
+#endif  //! CONTENT_HASH_H
@@ -0,0 +1,248 @@
+#ifndef DEPENDENCY_CACHE_H
+#define DEPENDENCY_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <output_sink.hpp>
+
+namespace fs = std::filesystem;
+
+namespace source {
+
+/**
+ * Last write time and size of a file, a changed stamp means the file has to be
+ * checked again
+ */
+struct FileStamp {
+  std::int64_t mtime = 0;
+  std::uint64_t size = 0;
+
+  bool operator==(FileStamp const& other) const {
+    return mtime == other.mtime && size == other.size;
+  }
+
+  /**
+   * Return the stamp of the file or nullopt if it can't be read
+   */
+  static std::optional<FileStamp> of(fs::path const& path) {
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    if (ec) {
+      return std::nullopt;
+    }
+
+    auto size = fs::file_size(path, ec);
+    if (ec) {
+      return std::nullopt;
+    }
+
+    return FileStamp{
+        static_cast<std::int64_t>(time.time_since_epoch().count()), size};
+  }
+};
+
+/**
+ * The direct includes of every file seen by a previous include crawl
+ *
+ * Stored in a binary file in native byte order:
+ *   magic, version, number of entries and for every entry
+ *   path, mtime, size, content hash, number of includes, includes
+ * where strings are written as their length followed by the characters
+ *
+ * The cache only saves work, a cache that can't be read is empty and one that
+ * can't be written is skipped with a warning
+ */
+class DependencyCache {
+ public:
+  struct Entry {
+    std::string path;
+    FileStamp stamp;
+    std::uint64_t hash = 0;
+    // the non standard includes as written in the file
+    std::vector<std::string> includes;
+  };
+
+ private:
+  inline static constexpr std::uint32_t magic = 0x4344505a;  // "ZPDC"
+  inline static constexpr std::uint32_t version = 1;
+
+  std::unordered_map<std::string, Entry> entries;
+  std::unordered_set<std::string> live;
+  bool validate = false;
+
+  template <class T>
+  static void write_pod(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  static void write_string(std::ostream& out, std::string const& str) {
+    write_pod<std::uint32_t>(out, str.size());
+    out.write(str.data(), str.size());
+  }
+
+  template <class T>
+  static bool read_pod(std::istream& in, T& value) {
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  /**
+   * If the rest of the file, up to end, holds at least bytes, so a corrupt
+   * count isn't allocated
+   */
+  static bool has_left(std::istream& in, std::uint64_t end,
+                       std::uint64_t bytes) {
+    auto position = in.tellg();
+    return position != std::istream::pos_type(-1) &&
+           static_cast<std::uint64_t>(position) <= end &&
+           bytes <= end - static_cast<std::uint64_t>(position);
+  }
+
+  static bool read_string(std::istream& in, std::uint64_t end,
+                          std::string& str) {
+    std::uint32_t size;
+    if (!read_pod(in, size) || !has_left(in, end, size)) {
+      return false;
+    }
+
+    str.resize(size);
+    return static_cast<bool>(in.read(str.data(), size));
+  }
+
+  static std::optional<Entry> read_entry(std::istream& in, std::uint64_t end) {
+    Entry entry;
+    std::uint32_t number_of_includes;
+    if (!read_string(in, end, entry.path) ||
+        !read_pod(in, entry.stamp.mtime) || !read_pod(in, entry.stamp.size) ||
+        !read_pod(in, entry.hash) || !read_pod(in, number_of_includes) ||
+        // every include is at least its length
+        !has_left(in, end,
+                  std::uint64_t{number_of_includes} * sizeof(std::uint32_t))) {
+      return std::nullopt;
+    }
+
+    entry.includes.resize(number_of_includes);
+    for (auto& include : entry.includes) {
+      if (!read_string(in, end, include)) {
+        return std::nullopt;
+      }
+    }
+
+    return entry;
+  }
+
+ public:
+  /**
+   * Load the cache from path
+   *
+   * Returns an empty cache if the file doesn't exist or isn't a valid cache
+   */
+  static DependencyCache load(fs::path const& path) {
+    DependencyCache cache;
+    std::error_code ec;
+    std::uint64_t end = fs::file_size(path, ec);
+    if (ec) {
+      return cache;
+    }
+
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    std::uint32_t file_magic, file_version, number_of_entries;
+    if (!read_pod(in, file_magic) || file_magic != magic ||
+        !read_pod(in, file_version) || file_version != version ||
+        !read_pod(in, number_of_entries)) {
+      return cache;
+    }
+
+    for (std::uint32_t i = 0; i < number_of_entries; ++i) {
+      auto entry = read_entry(in, end);
+      if (!entry) {
+        return DependencyCache{};
+      }
+
+      auto path = entry->path;
+      cache.entries.emplace(std::move(path), std::move(*entry));
+    }
+
+    return cache;
+  }
+
+  /**
+   * Write the updated entries through an OutputSink, so a reader never sees a
+   * partially written cache and processes saving the same cache don't clash
+   *
+   * Returns false, after a warning, if the cache couldn't be written
+   */
+  bool save(fs::path const& cache_path) const {
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    write_pod(out, magic);
+    write_pod(out, version);
+    write_pod<std::uint32_t>(out, live.size());
+    for (auto& path : live) {
+      auto& entry = entries.at(path);
+      write_string(out, entry.path);
+      write_pod(out, entry.stamp.mtime);
+      write_pod(out, entry.stamp.size);
+      write_pod(out, entry.hash);
+      write_pod<std::uint32_t>(out, entry.includes.size());
+      for (auto& include : entry.includes) {
+        write_string(out, include);
+      }
+    }
+
+    OutputSink sink{cache_path};
+    sink << out.str();
+    if (!sink.commit()) {
+      std::cerr << "can't write the dependency cache " << cache_path
+                << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Return the entry of the file at path or nullptr if there is none
+   */
+  Entry const* find(std::string const& path) const {
+    auto it = entries.find(path);
+    return it != entries.end() ? &it->second : nullptr;
+  }
+
+  /**
+   * Add or overwrite the entries
+   *
+   * Only entries updated since the cache was loaded are saved, so files that
+   * aren't included anymore are dropped
+   */
+  void update(std::vector<Entry>&& new_entries) {
+    for (auto& entry : new_entries) {
+      live.insert(entry.path);
+      auto path = entry.path;
+      entries.insert_or_assign(std::move(path), std::move(entry));
+    }
+  }
+
+  auto size() const { return entries.size(); }
+
+  /**
+   * In validation mode every file is parsed again and entries that would
+   * have been used but don't match the file are reported
+   */
+  void set_validate(bool value) { validate = value; }
+
+  bool is_validating() const { return validate; }
+};
+
+}  // namespace source
+
+#endif  //! DEPENDENCY_CACHE_H
@@ -0,0 +1,191 @@
+#ifndef GRAMMAR_PROFILE_H
+#define GRAMMAR_PROFILE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include <boost/spirit/home/x3.hpp>
+
+/**
+ * Counts how the named X3 rules of a grammar are used, to find the rules and
+ * alternatives that waste time
+ *
+ * For every rule it counts the attempts, the successes and failures, the bytes
+ * the successes consumed and the bytes a failure got through before it
+ * backtracked, i.e. the furthest any rule inside of it matched to
+ *
+ * The rules defined with GRAMMAR_PROFILE_DEFINE are only counted in a build
+ * with ZERO_PREPROCESSOR_PROFILE_GRAMMAR, where the report ranked by the bytes
+ * backtracked is printed to stderr at exit. Otherwise it is BOOST_SPIRIT_DEFINE
+ */
+namespace grammar_profile {
+
+struct RuleStats {
+  const char* name;
+  std::atomic<std::uint64_t> attempts{0};
+  std::atomic<std::uint64_t> successes{0};
+  std::atomic<std::uint64_t> bytes_consumed{0};
+  std::atomic<std::uint64_t> bytes_backtracked{0};
+
+  explicit RuleStats(const char* name) : name{name} {}
+
+  std::uint64_t failures() const { return attempts - successes; }
+};
+
+class Profile {
+  std::mutex mutex;
+  // a deque so the stats keep their address
+  std::deque<RuleStats> rules;
+  bool report_at_exit;
+
+ public:
+  explicit Profile(bool report_at_exit = false)
+      : report_at_exit{report_at_exit} {}
+
+  Profile(Profile const&) = delete;
+  Profile& operator=(Profile const&) = delete;
+
+  ~Profile() {
+    if (report_at_exit) {
+      report(std::cerr);
+    }
+  }
+
+  /**
+   * The profile reported at exit
+   */
+  static Profile& global() {
+    static Profile profile{true};
+    return profile;
+  }
+
+  /**
+   * The stats of the rule with the name, every instantiation of a rule's
+   * parse shares them
+   */
+  RuleStats& rule(const char* name) {
+    std::lock_guard lock{mutex};
+    auto it = std::find_if(rules.begin(), rules.end(), [name](auto& r) {
+      return std::strcmp(r.name, name) == 0;
+    });
+    return it != rules.end() ? *it : rules.emplace_back(name);
+  }
+
+  /**
+   * Print the rules that were tried, the most bytes backtracked first
+   */
+  void report(std::ostream& out) {
+    std::lock_guard lock{mutex};
+    std::vector<RuleStats const*> tried;
+    for (auto& r : rules) {
+      if (r.attempts != 0) {
+        tried.push_back(&r);
+      }
+    }
+    std::sort(tried.begin(), tried.end(), [](auto a, auto b) {
+      return a->bytes_backtracked != b->bytes_backtracked
+                 ? a->bytes_backtracked > b->bytes_backtracked
+                 : a->attempts > b->attempts;
+    });
+
+    out << std::left << std::setw(32) << "rule" << std::right << std::setw(12)
+        << "attempts" << std::setw(12) << "successes" << std::setw(12)
+        << "failures" << std::setw(14) << "consumed" << std::setw(14)
+        << "backtracked" << '\n';
+    for (auto r : tried) {
+      out << std::left << std::setw(32) << r->name << std::right
+          << std::setw(12) << r->attempts << std::setw(12) << r->successes
+          << std::setw(12) << r->failures() << std::setw(14)
+          << r->bytes_consumed << std::setw(14) << r->bytes_backtracked << '\n';
+    }
+    out << std::flush;
+  }
+};
+
+namespace detail {
+template <class Iterator>
+struct Frame {
+  Iterator start;
+  // the furthest a rule inside of it matched to, from start
+  std::ptrdiff_t furthest = 0;
+};
+
+// the rules being parsed on this thread, innermost last
+template <class Iterator>
+std::vector<Frame<Iterator>>& frames() {
+  thread_local std::vector<Frame<Iterator>> frames;
+  return frames;
+}
+}  // namespace detail
+
+/**
+ * Count the parse of a rule starting at first in its stats, parse returns if
+ * it matched and advances first if it did
+ */
+template <class Iterator, class Parse>
+bool profile(RuleStats& stats, Iterator& first, Parse&& parse) {
+  auto& frames = detail::frames<Iterator>();
+  frames.push_back({first});
+  bool matched = false;
+  try {
+    matched = parse();
+  } catch (...) {
+    frames.pop_back();
+    throw;
+  }
+
+  auto frame = frames.back();
+  frames.pop_back();
+  std::ptrdiff_t reached =
+      matched ? std::distance(frame.start, first) : frame.furthest;
+
+  ++stats.attempts;
+  if (matched) {
+    ++stats.successes;
+    stats.bytes_consumed += reached;
+  } else {
+    stats.bytes_backtracked += reached;
+  }
+
+  if (!frames.empty()) {
+    auto& parent = frames.back();
+    parent.furthest = std::max(
+        parent.furthest, std::distance(parent.start, frame.start) + reached);
+  }
+  return matched;
+}
+
+}  // namespace grammar_profile
+
+#ifdef ZERO_PREPROCESSOR_PROFILE_GRAMMAR
+// BOOST_SPIRIT_DEFINE_ with the parse counted in the global profile
+#define GRAMMAR_PROFILE_DEFINE_(r, data, rule_name)                          \
+  template <typename Iterator, typename Context>                             \
+  inline bool parse_rule(decltype(rule_name), Iterator& first,               \
+                         Iterator const& last, Context const& context,       \
+                         decltype(rule_name)::attribute_type& attr) {        \
+    using boost::spirit::x3::unused;                                         \
+    static auto const def_ = (rule_name = BOOST_PP_CAT(rule_name, _def));    \
+    static auto& stats =                                                     \
+        grammar_profile::Profile::global().rule(rule_name.name);             \
+    return grammar_profile::profile(stats, first, [&] {                      \
+      return def_.parse(first, last, context, unused, attr);                 \
+    });                                                                      \
+  }
+
+#define GRAMMAR_PROFILE_DEFINE(...) \
+  BOOST_PP_SEQ_FOR_EACH(GRAMMAR_PROFILE_DEFINE_, _, \
+                        BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__))
+#else
+#define GRAMMAR_PROFILE_DEFINE BOOST_SPIRIT_DEFINE
+#endif
+
+#endif  //! GRAMMAR_PROFILE_H
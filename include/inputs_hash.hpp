@@ -0,0 +1,93 @@
+#ifndef INPUTS_HASH_H
+#define INPUTS_HASH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <content_hash.hpp>
+#include <dependency_cache.hpp>
+#include <source_loader.hpp>
+
+namespace fs = std::filesystem;
+
+namespace source {
+
+/**
+ * The (in, out) paths of the sources processed by the last stage
+ */
+using SourcePairs = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * The path of the running executable, argv0 where it can't be read
+ */
+inline fs::path get_self_path(const char* argv0) {
+  fs::path self_path = argv0;
+#ifdef __linux__
+  std::error_code ec;
+  if (auto exe = fs::read_symlink("/proc/self/exe", ec); !ec) {
+    self_path = exe;
+  }
+#endif
+  return self_path;
+}
+
+/**
+ * Hash everything the outputs of the last stage depend on: the preprocessor at
+ * self, the options that change what it generates, the meta executable and the
+ * content and out path of all the sources
+ *
+ * NOTE: the preprocessor is identified by its own stamp as it is much bigger
+ * than the rest
+ */
+inline std::uint64_t get_inputs_hash(SourcePairs const& sources,
+                                     fs::path const& meta_exe,
+                                     fs::path const& self,
+                                     std::string_view options) {
+  auto hash = empty_content_hash;
+  if (auto stamp = FileStamp::of(self); stamp) {
+    hash = content_hash(std::to_string(stamp->mtime), hash);
+    hash = content_hash(std::to_string(stamp->size), hash);
+  }
+
+  SourceLoader loader{{}, "include"};
+  auto hash_file = [&](fs::path const& path) {
+    auto source = loader.load_source(path);
+    hash = content_hash(path.string() + '\0', hash);
+    hash = content_hash(source.begin(), source.end(), hash);
+  };
+
+  hash = content_hash(options, hash);
+  hash_file(meta_exe);
+  for (auto& [in, out] : sources) {
+    hash_file(in);
+    hash = content_hash(out + '\0', hash);
+  }
+
+  return hash;
+}
+
+/**
+ * Check if the outputs are up to date with the inputs hash stored in the stamp
+ */
+inline bool is_up_to_date(SourcePairs const& sources,
+                          fs::path const& stamp_path,
+                          std::uint64_t inputs_hash) {
+  std::ifstream stamp(stamp_path);
+  std::uint64_t previous_hash;
+  if (!(stamp >> previous_hash) || previous_hash != inputs_hash) {
+    return false;
+  }
+
+  return std::all_of(sources.begin(), sources.end(),
+                     [](auto& pair) { return fs::exists(pair.second); });
+}
+
+}  // namespace source
+
+#endif  //! INPUTS_HASH_H
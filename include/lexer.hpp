@@ -0,0 +1,322 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A hand written C++ lexer that splits a source into tokens in one pass
+ *
+ * It only finds where the tokens are and what kind they are, the parsers still
+ * parse the characters. A token array lets the statement loop classify and
+ * skip a token without running the rules on it
+ */
+namespace lexer {
+
+enum class TokenKind : std::uint8_t {
+  // spaces, tabs and line ends, the characters of rules::some_space
+  Space,
+  LineComment,
+  BlockComment,
+  Identifier,
+  Number,
+  // string literals with their prefix, raw strings included
+  String,
+  Char,
+  // a single character, an unterminated comment or literal starts with one
+  Punctuation
+};
+
+struct Token {
+  std::uint32_t offset;
+  std::uint32_t length;
+  TokenKind kind;
+
+  std::uint32_t end() const { return offset + length; }
+
+  bool is_blank() const {
+    return kind == TokenKind::Space || kind == TokenKind::LineComment ||
+           kind == TokenKind::BlockComment;
+  }
+};
+
+namespace detail {
+enum CharClass : std::uint8_t { Other, Blank, NameStart, Digit };
+
+struct CharClasses {
+  CharClass classes[256] = {};
+
+  constexpr CharClasses() {
+    for (char c : {' ', '\t', '\n', '\r'}) {
+      classes[static_cast<unsigned char>(c)] = Blank;
+    }
+    for (int c = 'a'; c <= 'z'; ++c) {
+      classes[c] = NameStart;
+      classes[c - 'a' + 'A'] = NameStart;
+    }
+    classes[static_cast<unsigned char>('_')] = NameStart;
+    for (int c = '0'; c <= '9'; ++c) {
+      classes[c] = Digit;
+    }
+  }
+};
+
+inline constexpr CharClasses char_classes{};
+
+inline CharClass class_of(char c) {
+  return char_classes.classes[static_cast<unsigned char>(c)];
+}
+
+inline bool is_space(char c) { return class_of(c) == Blank; }
+
+inline bool is_digit(char c) { return class_of(c) == Digit; }
+
+inline bool is_name(char c) {
+  auto char_class = class_of(c);
+  return char_class == NameStart || char_class == Digit;
+}
+
+/**
+ * The end of the quoted literal starting at i, npos if it isn't closed on the
+ * same line
+ */
+inline std::size_t quoted_end(std::string_view text, std::size_t i) {
+  char quote = text[i];
+  for (++i; i < text.size(); ++i) {
+    if (text[i] == '\\') {
+      ++i;
+    } else if (text[i] == quote) {
+      return i + 1;
+    } else if (text[i] == '\n') {
+      break;
+    }
+  }
+  return std::string_view::npos;
+}
+
+/**
+ * The end of the raw string R"delimiter(...)delimiter" whose quote is at i
+ */
+inline std::size_t raw_string_end(std::string_view text, std::size_t i) {
+  auto open = text.find('(', i);
+  if (open == std::string_view::npos || open - i > 17) {
+    return std::string_view::npos;
+  }
+
+  std::string closing = ")";
+  closing.append(text.substr(i + 1, open - i - 1));
+  closing += '"';
+  auto close = text.find(closing, open);
+  return close == std::string_view::npos ? close : close + closing.size();
+}
+}  // namespace detail
+
+/**
+ * Append the tokens of the text from the offset i, which must be the start of
+ * a token, up to the first token ending at or after stop
+ *
+ * Returns the end of the last token appended, lexing can go on from there
+ */
+inline std::size_t lex(std::string_view text, std::size_t i, std::size_t stop,
+                       std::vector<Token>& tokens) {
+  using namespace detail;
+  constexpr auto npos = std::string_view::npos;
+
+  stop = std::min(stop, text.size());
+  auto push = [&](std::size_t end, TokenKind kind) {
+    tokens.push_back({static_cast<std::uint32_t>(i),
+                      static_cast<std::uint32_t>(end - i), kind});
+    i = end;
+  };
+
+  while (i < stop) {
+    char c = text[i];
+    char next = i + 1 < text.size() ? text[i + 1] : '\0';
+    std::size_t end = i + 1;
+
+    auto char_class = class_of(c);
+    if (char_class == Blank) {
+      while (end < text.size() && is_space(text[end])) {
+        ++end;
+      }
+      push(end, TokenKind::Space);
+    } else if (c == '/' && next == '/') {
+      end = std::min(text.find_first_of("\r\n", i), text.size());
+      push(end, TokenKind::LineComment);
+    } else if (c == '/' && next == '*' &&
+               (end = text.find("*/", i + 2)) != npos) {
+      push(end + 2, TokenKind::BlockComment);
+    } else if (char_class == NameStart) {
+      while (end < text.size() && is_name(text[end])) {
+        ++end;
+      }
+
+      // a literal with a prefix like u8"" or R"()"
+      std::size_t literal_end = npos;
+      if (end < text.size() && (text[end] == '"' || text[end] == '\'')) {
+        auto name = text.substr(i, end - i);
+        if (name == "R" || name == "LR" || name == "uR" || name == "UR" ||
+            name == "u8R") {
+          literal_end = text[end] == '"' ? raw_string_end(text, end) : npos;
+        } else if (name == "L" || name == "u" || name == "U" || name == "u8") {
+          literal_end = quoted_end(text, end);
+        }
+      }
+
+      if (literal_end != npos) {
+        push(literal_end,
+             text[end] == '"' ? TokenKind::String : TokenKind::Char);
+      } else {
+        push(end, TokenKind::Identifier);
+      }
+    } else if (char_class == Digit || (c == '.' && is_digit(next))) {
+      while (end < text.size()) {
+        char d = text[end];
+        bool exponent_sign =
+            (d == '+' || d == '-') &&
+            (text[end - 1] == 'e' || text[end - 1] == 'E' ||
+             text[end - 1] == 'p' || text[end - 1] == 'P');
+        if (!is_name(d) && d != '.' && d != '\'' && !exponent_sign) {
+          break;
+        }
+        ++end;
+      }
+      push(end, TokenKind::Number);
+    } else if ((c == '"' || c == '\'') &&
+               (end = quoted_end(text, i)) != npos) {
+      push(end, c == '"' ? TokenKind::String : TokenKind::Char);
+    } else {
+      push(i + 1, TokenKind::Punctuation);
+    }
+  }
+
+  return i;
+}
+
+/**
+ * Split the text into tokens, every character belongs to exactly one token
+ */
+inline std::vector<Token> tokenize(std::string_view text) {
+  std::vector<Token> tokens;
+  lex(text, 0, text.size(), tokens);
+  return tokens;
+}
+
+/**
+ * The tokens of one source, looked up by the position of their first
+ * character
+ *
+ * The source is lexed a window at a time as the lookups go forward, the tokens
+ * behind the last lookup are dropped. It keeps the tokens in the cache, the
+ * token array of a whole file would be several times its size. A lookup
+ * behind the window finds no token
+ */
+class TokenStream {
+  // the characters lexed ahead of a lookup
+  static constexpr std::size_t window = 4096;
+
+  std::string_view text;
+  const char* base = nullptr;
+  std::vector<Token> tokens;
+  // the first token that may still be looked up
+  std::size_t cursor = 0;
+  std::size_t lexed_to = 0;
+
+  /**
+   * Drop the tokens before the cursor and lex the next window
+   */
+  bool lex_more() {
+    if (lexed_to == text.size()) {
+      return false;
+    }
+
+    tokens.erase(tokens.begin(), tokens.begin() + cursor);
+    cursor = 0;
+    lexed_to = lex(text, lexed_to, lexed_to + window, tokens);
+    return true;
+  }
+
+ public:
+  /**
+   * Lex the text from begin to end, tokens are found from begin on
+   */
+  void tokenize(const char* begin, const char* end) {
+    text = {begin, static_cast<std::size_t>(end - begin)};
+    base = begin;
+    tokens.clear();
+    cursor = 0;
+    lexed_to = 0;
+  }
+
+  void clear() { tokenize(nullptr, nullptr); }
+
+  std::string_view get_text(Token const& token) const {
+    return text.substr(token.offset, token.length);
+  }
+
+  /**
+   * The token starting at the position, nullptr if the position is inside a
+   * token or not in the window
+   */
+  Token const* at(const char* position) {
+    if (base == nullptr || position < base) {
+      return nullptr;
+    }
+
+    auto offset = static_cast<std::size_t>(position - base);
+    if (cursor < tokens.size() && tokens[cursor].offset > offset) {
+      return nullptr;
+    }
+
+    while (true) {
+      while (cursor < tokens.size() && tokens[cursor].end() <= offset) {
+        ++cursor;
+      }
+      if (cursor < tokens.size() || !lex_more()) {
+        break;
+      }
+    }
+
+    if (cursor == tokens.size() || tokens[cursor].offset != offset) {
+      return nullptr;
+    }
+    return &tokens[cursor];
+  }
+
+  /**
+   * The end of the spaces and comments starting at the position, the position
+   * itself if there are none
+   */
+  const char* skip_blank(const char* position) {
+    if (at(position) == nullptr) {
+      return position;
+    }
+
+    // the cursor is on the token at the position, lex_more keeps it
+    auto end = position;
+    for (auto i = cursor;; ++i) {
+      if (i == tokens.size()) {
+        auto lexed = i - cursor;
+        if (!lex_more()) {
+          break;
+        }
+        i = cursor + lexed;
+      }
+      if (!tokens[i].is_blank()) {
+        break;
+      }
+      end = base + tokens[i].end();
+    }
+
+    return end;
+  }
+};
+
+}  // namespace lexer
+
+#endif  //! LEXER_H
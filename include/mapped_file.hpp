@@ -0,0 +1,107 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace source {
+
+/**
+ * A read-only memory mapping of an entire regular file
+ *
+ * Lets the parsers iterate the file's content directly without copying it
+ *
+ * NOTE: files are only mapped on POSIX, on Windows they are read into a buffer
+ * on purpose. There a mapped file can't be replaced or removed while it is
+ * mapped, so a build step or an editor writing a source being processed would
+ * fail, and mapping would need <windows.h> in this header
+ */
+class MappedFile {
+  const char* data = nullptr;
+  std::size_t size = 0;
+
+  MappedFile(const char* data, std::size_t size) : data{data}, size{size} {}
+
+  void unmap() noexcept {
+#ifndef _WIN32
+    if (data != nullptr) {
+      ::munmap(const_cast<char*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+  }
+
+ public:
+  MappedFile() = default;
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  MappedFile(MappedFile&& f) noexcept
+      : data{std::exchange(f.data, nullptr)}, size{std::exchange(f.size, 0)} {}
+
+  MappedFile& operator=(MappedFile&& f) noexcept {
+    if (this != &f) {
+      unmap();
+      data = std::exchange(f.data, nullptr);
+      size = std::exchange(f.size, 0);
+    }
+    return *this;
+  }
+
+  ~MappedFile() noexcept { unmap(); }
+
+  /**
+   * Map the file at path
+   *
+   * Returns nullopt if the file is not a regular non-empty file (e.g. a pipe
+   * or stdin) or on Windows, callers should fall back to reading the file
+   */
+  static std::optional<MappedFile> open(std::filesystem::path const& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return std::nullopt;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+        info.st_size == 0) {
+      ::close(fd);
+      return std::nullopt;
+    }
+
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // NOTE: the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      return std::nullopt;
+    }
+
+    // the parsers go through the file front to back
+    ::madvise(data, size, MADV_SEQUENTIAL);
+    return MappedFile{static_cast<const char*>(data), size};
+#else
+    (void)path;
+    return std::nullopt;
+#endif
+  }
+
+  std::string_view view() const { return {data, size}; }
+};
+
+}  // namespace source
+
+#endif  //! MAPPED_FILE_H
@@ -0,0 +1,210 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <boost/spirit/home/x3.hpp>
+
+/**
+ * Packrat memoization of X3 rules
+ *
+ * A memoized rule remembers how it ended at every position it was tried at,
+ * so trying it again at the same position, from another alternative or after
+ * an enclosing rule backtracked, is answered from a table instead of parsing
+ * it again
+ *
+ * The table is passed in the context with x3::with<memo::memo_tag>, without
+ * it or with a null table a memoized rule is parsed as usual
+ */
+namespace memo {
+namespace x3 = boost::spirit::x3;
+
+struct memo_tag;
+
+namespace detail {
+// the address identifies the rule in the table
+template <class Rule>
+inline const char rule_id = 0;
+}  // namespace detail
+
+/**
+ * How the memoized rules ended at the positions of one input, the positions
+ * are the addresses of the characters so it must be cleared for another input
+ */
+class MemoTable {
+  struct Slot {
+    const void* rule = nullptr;
+    const void* position = nullptr;
+    // the length of the match or failed
+    std::ptrdiff_t length = 0;
+  };
+
+  // open addressing with linear probing, a power of two slots at most half
+  // full, no allocation per result
+  std::vector<Slot> slots = std::vector<Slot>(1024);
+  std::size_t used = 0;
+
+  std::size_t hits = 0;
+
+  std::size_t slot_of(const void* rule, const void* position) const {
+    std::uint64_t h = reinterpret_cast<std::uintptr_t>(position);
+    h = (h * 0x9E3779B97F4A7C15u) ^ reinterpret_cast<std::uintptr_t>(rule);
+    return static_cast<std::size_t>(h ^ (h >> 29)) & (slots.size() - 1);
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    used = 0;
+    for (auto& slot : old) {
+      if (slot.rule != nullptr) {
+        insert(slot.rule, slot.position, slot.length);
+      }
+    }
+  }
+
+ public:
+  static constexpr std::ptrdiff_t failed = -1;
+
+  /**
+   * The length the rule matched at the position, nullptr if not recorded
+   */
+  std::ptrdiff_t const* find(const void* rule, const void* position) {
+    for (auto i = slot_of(rule, position);; i = (i + 1) & (slots.size() - 1)) {
+      auto& slot = slots[i];
+      if (slot.rule == nullptr) {
+        return nullptr;
+      }
+      if (slot.rule == rule && slot.position == position) {
+        ++hits;
+        return &slot.length;
+      }
+    }
+  }
+
+  void insert(const void* rule, const void* position, std::ptrdiff_t length) {
+    if (2 * (used + 1) > slots.size()) {
+      grow();
+    }
+
+    for (auto i = slot_of(rule, position);; i = (i + 1) & (slots.size() - 1)) {
+      auto& slot = slots[i];
+      if (slot.rule == nullptr) {
+        slot = {rule, position, length};
+        ++used;
+        return;
+      }
+      if (slot.rule == rule && slot.position == position) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * The number of results answered from the table
+   */
+  std::size_t get_hits() const { return hits; }
+
+  std::size_t size() const { return used; }
+
+  /**
+   * Forget all the results, the memory is kept for the next input
+   */
+  void clear() {
+    if (used != 0) {
+      std::fill(slots.begin(), slots.end(), Slot{});
+      used = 0;
+    }
+  }
+};
+
+/**
+ * Parses the rule Subject through the MemoTable of the context
+ *
+ * Only the failures of a rule with an attribute are recorded, replaying its
+ * successes would copy the attribute out of the table at every level of a
+ * nested type, which costs more than parsing it again. A rule without one is
+ * replayed by skipping the length it matched
+ *
+ * The rule must not have semantic actions with side effects, they don't run
+ * when the result comes from the table
+ */
+template <class Subject>
+struct memoized : x3::unary_parser<Subject, memoized<Subject>> {
+  using base_type = x3::unary_parser<Subject, memoized<Subject>>;
+  using attribute_type = typename Subject::attribute_type;
+  static bool const has_attribute = Subject::has_attribute;
+  static bool const handles_container = Subject::handles_container;
+
+  constexpr memoized(Subject const& subject) : base_type(subject) {}
+
+  template <class Iterator, class Context, class RContext, class Attribute>
+  bool parse(Iterator& first, Iterator const& last, Context const& context,
+             RContext& rcontext, Attribute& attr) const {
+    MemoTable* table = nullptr;
+    auto&& found = x3::get<memo_tag>(context);
+    if constexpr (!std::is_same_v<std::decay_t<decltype(found)>,
+                                  x3::unused_type>) {
+      table = found;
+    }
+
+    if (table == nullptr || first == last) {
+      return parse_subject(first, last, context, rcontext, attr);
+    }
+
+    const void* rule = &detail::rule_id<Subject>;
+    const void* position = std::addressof(*first);
+    if (auto length = table->find(rule, position)) {
+      if (*length == MemoTable::failed) {
+        return false;
+      }
+
+      std::advance(first, *length);
+      return true;
+    }
+
+    auto begin = first;
+    bool parsed = parse_subject(first, last, context, rcontext, attr);
+    if (!parsed) {
+      table->insert(rule, position, MemoTable::failed);
+    } else if constexpr (!has_attribute) {
+      table->insert(rule, position, std::distance(begin, first));
+    }
+
+    return parsed;
+  }
+
+ private:
+  template <class Iterator, class Context, class RContext, class Attribute>
+  bool parse_subject(Iterator& first, Iterator const& last,
+                     Context const& context, RContext& rcontext,
+                     Attribute& attr) const {
+    if constexpr (has_attribute) {
+      // the rule gets its own attribute like when it is used directly
+      attribute_type value{};
+      if (!this->subject.parse(first, last, context, rcontext, value)) {
+        return false;
+      }
+
+      x3::traits::move_to(value, attr);
+      return true;
+    } else {
+      return this->subject.parse(first, last, context, rcontext, attr);
+    }
+  }
+};
+
+template <class Rule>
+constexpr memoized<Rule> memoize(Rule const& rule) {
+  return {rule};
+}
+
+}  // namespace memo
+
+#endif  //! MEMO_H
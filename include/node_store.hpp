@@ -0,0 +1,161 @@
+#ifndef NODE_STORE_H
+#define NODE_STORE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace node_store {
+
+template <class T, class... Nodes>
+struct index_of;
+
+template <class T, class... Nodes>
+struct index_of<T, T, Nodes...> : std::integral_constant<std::uint8_t, 0> {};
+
+template <class T, class Node, class... Nodes>
+struct index_of<T, Node, Nodes...>
+    : std::integral_constant<std::uint8_t,
+                             1 + index_of<T, Nodes...>::value> {};
+
+template <class T, class... Nodes>
+inline constexpr std::uint8_t index_of_v = index_of<T, Nodes...>::value;
+
+/**
+ * A node in a NodeStore, the type of the node and its index in the pool of
+ * that type
+ */
+template <class... Nodes>
+struct Handle {
+  std::uint32_t index;
+  std::uint8_t type;
+
+  template <class T>
+  bool is() const {
+    return type == index_of_v<T, Nodes...>;
+  }
+};
+
+/**
+ * A stack of nodes of different types kept in one pool per type, the stack
+ * itself only holds handles
+ *
+ * Pushing or popping a node doesn't move the other nodes and only a node of
+ * the same type can be moved by a push when its pool grows. As the nodes are
+ * pushed and popped in stack order every pool is a stack too, so a popped node
+ * is always the last of its pool
+ */
+template <class... Nodes>
+class NodeStore {
+  static_assert(sizeof...(Nodes) <= 256, "the type of a node is a uint8_t");
+
+ public:
+  using handle_type = Handle<Nodes...>;
+
+  template <class T>
+  static constexpr bool can_store = (std::is_same_v<T, Nodes> || ...);
+
+ private:
+  std::tuple<std::vector<Nodes>...> pools;
+  std::vector<handle_type> handles;
+
+  template <class T>
+  auto& pool() {
+    return std::get<std::vector<T>>(pools);
+  }
+
+  template <class T>
+  auto const& pool() const {
+    return std::get<std::vector<T>>(pools);
+  }
+
+  template <class F, std::size_t... I>
+  decltype(auto) visit(F& f, handle_type h, std::index_sequence<I...>) {
+    using R = decltype(f(std::get<0>(pools).front()));
+    using Visit = R (*)(NodeStore&, F&, std::uint32_t);
+    static constexpr Visit table[] = {
+        [](NodeStore& store, F& f, std::uint32_t index) -> R {
+          return f(std::get<I>(store.pools)[index]);
+        }...};
+    return table[h.type](*this, f, h.index);
+  }
+
+ public:
+  std::size_t size() const { return handles.size(); }
+
+  bool empty() const { return handles.empty(); }
+
+  /**
+   * The handles from the bottom to the top of the stack
+   */
+  auto const& get_handles() const { return handles; }
+
+  handle_type front() const { return handles.front(); }
+
+  handle_type back() const { return handles.back(); }
+
+  handle_type operator[](std::size_t i) const { return handles[i]; }
+
+  /**
+   * Push the node on the top of the stack and return it
+   */
+  template <class T>
+  std::decay_t<T>& push(T&& node) {
+    using Node = std::decay_t<T>;
+    auto& nodes = pool<Node>();
+    handles.push_back({static_cast<std::uint32_t>(nodes.size()),
+                       index_of_v<Node, Nodes...>});
+    return nodes.emplace_back(std::forward<T>(node));
+  }
+
+  void pop() {
+    visit([this](auto& node) { pop_back_of(node); }, handles.back());
+    handles.pop_back();
+  }
+
+  /**
+   * The node of the handle, which must be a T
+   */
+  template <class T>
+  T& get(handle_type h) {
+    assert(h.template is<T>());
+    return pool<T>()[h.index];
+  }
+
+  template <class T>
+  T const& get(handle_type h) const {
+    assert(h.template is<T>());
+    return pool<T>()[h.index];
+  }
+
+  /**
+   * Call f with the node of the handle, f must accept every type of node and
+   * return the same type for all of them
+   */
+  template <class F>
+  decltype(auto) visit(F&& f, handle_type h) {
+    return visit(f, h, std::index_sequence_for<Nodes...>{});
+  }
+
+  /**
+   * Remove all the nodes, the pools keep their capacity
+   */
+  void clear() {
+    std::apply([](auto&... nodes) { (nodes.clear(), ...); }, pools);
+    handles.clear();
+  }
+
+ private:
+  template <class T>
+  void pop_back_of(T&) {
+    pool<T>().pop_back();
+  }
+};
+
+}  // namespace node_store
+
+#endif  //! NODE_STORE_H
@@ -0,0 +1,249 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <trace.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+namespace source {
+
+/**
+ * Writes an output file in large blocks
+ *
+ * The spans written are copied into a buffer that is flushed when full, a
+ * span larger than the buffer is written along with it without a copy. The
+ * file is written to a temporary file beside path and renamed to path on
+ * commit, so a reader never sees a partially written output. If the sink is
+ * destroyed without a commit the temporary file is removed
+ *
+ * Like a stream a sink that failed to open or write drops what is written
+ * and converts to false
+ */
+class OutputSink {
+  static constexpr std::size_t buffer_size = 1 << 16;
+
+  std::filesystem::path path;
+  std::filesystem::path tmp_path;
+  std::string buffer;
+  bool good = false;
+
+#ifndef _WIN32
+  using Handle = int;
+  static constexpr Handle no_file = -1;
+#else
+  using Handle = std::FILE*;
+  static constexpr Handle no_file = nullptr;
+#endif
+  Handle file = no_file;
+
+  /**
+   * A temporary path beside path unique to the sink, the sinks of other threads
+   * and processes writing the same output don't share it
+   */
+  static std::filesystem::path temporary_path(
+      std::filesystem::path const& path) {
+    static std::atomic<std::uint64_t> sinks{0};
+#ifndef _WIN32
+    auto process = ::getpid();
+#else
+    auto process = ::_getpid();
+#endif
+    auto tmp = path;
+    tmp += '.' + std::to_string(process) + '.' + std::to_string(sinks++) +
+           ".tmp";
+    return tmp;
+  }
+
+  /**
+   * Write the buffer and then the span to the file
+   */
+  void write_out(std::string_view span = {}) {
+    if (!good || (buffer.empty() && span.empty())) {
+      buffer.clear();
+      return;
+    }
+
+    trace::Span traced{"io", "write"};
+#ifndef _WIN32
+    // NOTE: both are gathered in one system call
+    iovec pieces[] = {{buffer.data(), buffer.size()},
+                      {const_cast<char*>(span.data()), span.size()}};
+    iovec* first = pieces;
+    int count = 2;
+    while (count != 0) {
+      auto written = ::writev(file, first, count);
+      if (written < 0) {
+        good = false;
+        break;
+      }
+
+      auto left = static_cast<std::size_t>(written);
+      for (; count != 0 && left >= first->iov_len; ++first, --count) {
+        left -= first->iov_len;
+      }
+      if (count != 0) {
+        first->iov_base = static_cast<char*>(first->iov_base) + left;
+        first->iov_len -= left;
+      }
+    }
+#else
+    good = std::fwrite(buffer.data(), 1, buffer.size(), file) ==
+               buffer.size() &&
+           std::fwrite(span.data(), 1, span.size(), file) == span.size();
+#endif
+
+    buffer.clear();
+  }
+
+  /**
+   * Close the file, true if everything written reached it
+   */
+  bool close() {
+    if (file != no_file) {
+#ifndef _WIN32
+      good = ::close(file) == 0 && good;
+#else
+      good = std::fclose(file) == 0 && good;
+#endif
+      file = no_file;
+    }
+    return good;
+  }
+
+  void discard() {
+    if (!tmp_path.empty()) {
+      close();
+      std::error_code ec;
+      std::filesystem::remove(tmp_path, ec);
+      tmp_path.clear();
+    }
+  }
+
+ public:
+  OutputSink() = default;
+
+  /**
+   * Open the temporary file of the output at path, the output itself is
+   * replaced on commit
+   */
+  explicit OutputSink(std::filesystem::path out_path)
+      : path{std::move(out_path)}, tmp_path{temporary_path(path)} {
+    buffer.reserve(buffer_size);
+#ifndef _WIN32
+    file = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0666);
+#else
+    file = std::fopen(tmp_path.string().c_str(), "wb");
+#endif
+    good = file != no_file;
+    if (!good) {
+      tmp_path.clear();
+    }
+  }
+
+  OutputSink(OutputSink const&) = delete;
+  OutputSink& operator=(OutputSink const&) = delete;
+
+  OutputSink(OutputSink&& s) noexcept
+      : path{std::move(s.path)},
+        tmp_path{std::exchange(s.tmp_path, {})},
+        buffer{std::move(s.buffer)},
+        good{std::exchange(s.good, false)},
+        file{std::exchange(s.file, no_file)} {}
+
+  OutputSink& operator=(OutputSink&& s) noexcept {
+    if (this != &s) {
+      discard();
+      path = std::move(s.path);
+      tmp_path = std::exchange(s.tmp_path, {});
+      buffer = std::move(s.buffer);
+      good = std::exchange(s.good, false);
+      file = std::exchange(s.file, no_file);
+    }
+    return *this;
+  }
+
+  ~OutputSink() { discard(); }
+
+  explicit operator bool() const { return good; }
+
+  void write(std::string_view span) {
+    if (buffer.size() + span.size() <= buffer_size) {
+      buffer.append(span);
+    } else if (span.size() < buffer_size) {
+      write_out();
+      buffer.append(span);
+    } else {
+      write_out(span);
+    }
+  }
+
+  void put(char c) {
+    if (buffer.size() == buffer_size) {
+      write_out();
+    }
+    buffer.push_back(c);
+  }
+
+  OutputSink& operator<<(std::string_view span) {
+    write(span);
+    return *this;
+  }
+
+  OutputSink& operator<<(char c) {
+    put(c);
+    return *this;
+  }
+
+  /**
+   * Write everything buffered to the temporary file
+   */
+  void flush() { write_out(); }
+
+  /**
+   * Write everything buffered and replace the output with the temporary file
+   *
+   * Returns false and removes the temporary file if anything failed
+   */
+  bool commit() {
+    if (tmp_path.empty()) {
+      return false;
+    }
+
+    trace::Span traced{"io", "commit", path};
+    flush();
+    if (!close()) {
+      discard();
+      return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+      discard();
+      return false;
+    }
+
+    tmp_path.clear();
+    return true;
+  }
+};
+
+}  // namespace source
+
+#endif  //! OUTPUT_SINK_H
@@ -2,20 +2,30 @@
 #define PREPROCESSOR_H
 
 #include <cstddef>
+#include <exception>
 #include <functional>
+#include <future>
+#include <iostream>
+#include <iterator>
 #include <memory>
 #include <optional>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include <concurrent.hpp>
+#include <content_hash.hpp>
+#include <dependency_cache.hpp>
 #include <detect.hpp>
 #include <error_reporter.hpp>
 #include <result.hpp>
 #include <source_loader.hpp>
+#include <trace.hpp>
 
 template <typename... Functions>
 class Preprocessor {
@@ -108,7 +118,12 @@ class Preprocessor {
    */
   template <int N = 0, typename Source, typename Writer>
   auto process(Source& source, Writer& writer) {
-    auto out = std::get<N>(parsers).parse(source);
+    auto out = [&] {
+      static const std::string name =
+          "parser " + std::to_string(parser_type<N>::id);
+      trace::Span traced{"process", name};
+      return std::get<N>(parsers).parse(source);
+    }();
     if (out) {
       writer(out->result);
       return out->processed_to;
@@ -194,6 +209,24 @@ class Preprocessor {
     }
   }
 
+  template <class T>
+  using reset_fun = decltype(std::declval<T>().reset());
+
+  /**
+   * Call reset on all parsers that have one, so what they kept of a file is
+   * released when it is done
+   */
+  template <int N = 0>
+  void reset_parsers() {
+    if constexpr (is_detected_v<reset_fun, parser_type<N>>) {
+      std::get<N>(parsers).reset();
+    }
+
+    if constexpr (N + 1 < number_of_parsers) {
+      reset_parsers<N + 1>();
+    }
+  }
+
   template <class T>
   using get_prepend_fun = decltype(std::declval<T>().get_prepend());
 
@@ -235,12 +268,160 @@ class Preprocessor {
     }
   }
 
+  /**
+   * A non standard include of a source, path is empty if it can't be found
+   */
+  struct Include {
+    std::string name;
+    std::optional<std::string> path;
+  };
+
+  using IncludeGraph = std::unordered_map<std::string, std::vector<Include>>;
+
+  /**
+   * Return the cache entry with the non standard includes of the source
+   *
+   * The source is only loaded if its stamp changed since it was cached and
+   * only parsed if its content changed too
+   */
+  template <class StdParser>
+  source::DependencyCache::Entry scan_includes(
+      std::string const& path, StdParser& std_parser,
+      source::DependencyCache const& cache) {
+    auto cached = cache.find(path);
+    auto stamp = source::FileStamp::of(path);
+    bool same_stamp = cached != nullptr && stamp && cached->stamp == *stamp;
+    if (same_stamp && !cache.is_validating()) {
+      return *cached;
+    }
+
+    auto source = source_loader.load_source(path);
+    source::DependencyCache::Entry entry{
+        path, stamp.value_or(source::FileStamp{}),
+        source::content_hash(source.begin(), source.end()), {}};
+    if (cached != nullptr && cached->hash == entry.hash &&
+        !cache.is_validating()) {
+      entry.includes = cached->includes;
+      return entry;
+    }
+
+    for (auto& dep : std_parser.get_includes(source)) {
+      if (!source::is_standard(dep)) {
+        entry.includes.push_back(dep);
+      }
+    }
+
+    if (same_stamp && (cached->hash != entry.hash ||
+                       cached->includes != entry.includes)) {
+      std::cerr << "stale dependency cache entry for " + path + '\n';
+    }
+
+    return entry;
+  }
+
+  /**
+   * Load and scan every source reachable from source_name for includes
+   *
+   * Each worker uses its own std parser and takes sources from a work stealing
+   * queue, a found include is queued only by the worker that first sees it
+   *
+   * The cache is used to skip unchanged sources and then updated with the
+   * entries of all the crawled sources
+   *
+   * Rethrows the first error of a worker after all of them are done
+   */
+  IncludeGraph crawl_includes(std::string const& source_name, std::size_t jobs,
+                              source::DependencyCache& cache) {
+    using StdParser = parser_by_id<std_parser_id>;
+
+    std::vector<IncludeGraph> graphs(jobs);
+    std::vector<std::vector<source::DependencyCache::Entry>> entries(jobs);
+    std::vector<std::exception_ptr> errors(jobs);
+    concurrent::WorkStealingQueues<std::string> queue{jobs};
+    concurrent::ShardedSet<std::string> visited;
+
+    auto crawl = [&](std::size_t worker) {
+      StdParser std_parser{};
+      auto& graph = graphs[worker];
+      while (!queue.finished()) {
+        auto name = queue.pop(worker);
+        if (!name) {
+          std::this_thread::yield();
+          continue;
+        }
+
+        try {
+          auto entry = scan_includes(*name, std_parser, cache);
+          std::vector<Include> includes;
+          for (auto& dep : entry.includes) {
+            auto& include = includes.emplace_back(Include{dep, std::nullopt});
+            if (auto path = source_loader.find_source(dep); path) {
+              include.path = path.value().string();
+              if (visited.insert(*include.path)) {
+                queue.push(worker, *include.path);
+              }
+            }
+          }
+          graph.emplace(std::move(*name), std::move(includes));
+          entries[worker].push_back(std::move(entry));
+        } catch (...) {
+          if (!errors[worker]) {
+            errors[worker] = std::current_exception();
+          }
+        }
+
+        queue.done();
+      }
+    };
+
+    queue.push(0, source_name);
+    if (jobs == 1) {
+      crawl(0);
+    } else {
+      std::vector<std::thread> workers;
+      for (std::size_t i = 0; i < jobs; ++i) {
+        workers.emplace_back(crawl, i);
+      }
+
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    }
+
+    for (auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    auto& graph = graphs.front();
+    auto& all_entries = entries.front();
+    for (std::size_t i = 1; i < jobs; ++i) {
+      graph.merge(graphs[i]);
+      std::move(entries[i].begin(), entries[i].end(),
+                std::back_inserter(all_entries));
+    }
+    cache.update(std::move(all_entries));
+
+    return std::move(graph);
+  }
+
+  /**
+   * Output that is only known later e.g. a class still generated by the meta
+   * process, the output following it is held back to keep the order
+   */
+  struct DeferredOutput {
+    std::future<std::string> output;
+    std::string following;
+  };
+
   // Data members
   source::SourceLoader source_loader;
   ErrorReporter reporter;
   Parsers parsers;
 
   std::string current_file_name;
+  std::vector<DeferredOutput> deferred_output;
 
  public:
   Preprocessor(source::SourceLoader&& loader, Functions... funs)
@@ -267,11 +448,23 @@ class Preprocessor {
    */
   template <typename Writer>
   void process_source(std::string_view source_name, Writer& writer) {
+    trace::Span traced{"process", "process_source", source_name};
     auto source = source_loader.load_source(source_name);
     current_file_name = source_name;
+    deferred_output.clear();
+
+    auto ordered_writer = [this, &writer](auto& src) {
+      if (deferred_output.empty()) {
+        writer(src);
+      } else {
+        deferred_output.back().following.append(std::begin(src),
+                                                std::end(src));
+      }
+    };
+
     prepend_to_file(writer);
     while (!source.is_finished()) {
-      auto processed_to = process(source, writer);
+      auto processed_to = process(source, ordered_writer);
 
       std::size_t processed_chars = std::distance(source.begin(), processed_to);
       if (processed_chars == 0) {
@@ -280,52 +473,83 @@ class Preprocessor {
 
       source.advance(processed_chars);
     }
+
+    reset_parsers();
+
+    for (auto& deferred : deferred_output) {
+      auto output = [&] {
+        trace::Span traced{"meta", "wait for the meta classes"};
+        return deferred.output.get();
+      }();
+      writer(output);
+      writer(deferred.following);
+    }
+    deferred_output.clear();
+  }
+
+  /**
+   * Write output that a parser only gets later at the current position, it is
+   * waited for when the source is processed
+   *
+   * NOTE: only valid while inside process_source
+   */
+  void write_deferred(std::future<std::string> output) {
+    deferred_output.push_back({std::move(output), {}});
   }
 
   /**
    * Write the dependencies of the source using the writer
    *
+   * The include graph is crawled by jobs threads and then walked depth first,
+   * so the output is the same for any number of jobs
+   *
    * Terminates if a found dependency file can't be opened
    */
   template <typename Writer>
-  void get_dependencies(std::string source_name, Writer& writer) {
+  void get_dependencies(std::string source_name, Writer& writer,
+                        std::size_t jobs = 1) {
+    source::DependencyCache cache;
+    get_dependencies(std::move(source_name), writer, jobs, cache);
+  }
+
+  /**
+   * Write the dependencies of the source using the writer, only the sources
+   * that changed since they were added to the cache are parsed
+   *
+   * The cache is updated with the includes of all the crawled sources
+   */
+  template <typename Writer>
+  void get_dependencies(std::string source_name, Writer& writer,
+                        std::size_t jobs, source::DependencyCache& cache) {
+    auto graph = crawl_includes(source_name, jobs, cache);
+
     std::unordered_set<std::string> dependencies;
     std::vector<std::string> sources = {std::move(source_name)};
-    constexpr int parser_idx = get_parsers_idx_with_error<std_parser_id>();
-    auto& std_parser = std::get<parser_idx>(parsers);
     while (!sources.empty()) {
-      auto& name = sources.back();
-      auto source = source_loader.load_source(name);
-      // process source
-      auto deps = std_parser.get_includes(source);
-      // remove processed
+      auto name = std::move(sources.back());
       sources.pop_back();
 
-      // add new to be processed
-      for (auto& dep : deps) {
-        if (source::is_standard(dep)) {
+      for (auto& include : graph[name]) {
+        if (!include.path) {
+          std::cout << "file " << include.name << " can't be found\n";
           continue;
         }
 
-        if (auto include = source_loader.find_source(dep); include) {
-          auto name = include.value().string();
-          auto [it, ok] = dependencies.emplace(name);
-          if (ok) {
-            // write the dependencies using the writer
-            writer(name);
-            auto out = source_loader.get_out_path(dep).string();
-            writer(out);
+        auto [it, ok] = dependencies.emplace(*include.path);
+        if (ok) {
+          // write the dependencies using the writer
+          writer(*include.path);
+          auto out = source_loader.get_out_path(include.name).string();
+          writer(out);
 
-            sources.push_back(std::move(name));
-          }
-        } else {
-          std::cout << "file " << dep << " can't be found\n";
+          sources.push_back(*include.path);
         }
       }
     }
   }
 
   void preprocess_source(std::string_view source_path) {
+    trace::Span traced{"process", "preprocess_source", source_path};
     auto source = source_loader.load_source(source_path);
     auto source_name = source::get_source_name(source_path);
     start_preprocess(source_name);
@@ -341,6 +565,7 @@ class Preprocessor {
     }
 
     finish_preprocess();
+    reset_parsers();
   }
 
   /*
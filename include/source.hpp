@@ -2,27 +2,74 @@
 #define SOURCE_H
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
+
+#include <char_scan.hpp>
 
-// TODO: make the Source work with files or iterators
 class Source {
   // Data members
 
-  // TODO: for now just a string representing the source code
-  const std::string source;
+  // keeps the memory viewed by source alive e.g. an owned string or a mapped
+  // file
+  std::shared_ptr<const void> storage;
+  std::string_view source;
   const std::string name;
 
   std::size_t processed_till = 0;
 
-  std::uint16_t rows_processed = 1;
-  std::uint16_t column = 0;
+  // the offsets where the lines start, indexed the first time a location is
+  // asked for so advancing doesn't look at the characters
+  mutable std::vector<std::uint32_t> line_starts;
+
+  // tells the sources apart even if one is read into the memory of another,
+  // the copies of a source view the same text and keep its id
+  std::uint64_t id = next_id();
+
+  static std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> last_id{0};
+    return ++last_id;
+  }
+
+  /**
+   * The index of the line of the first unprocessed character
+   */
+  std::size_t current_line() const {
+    if (line_starts.empty()) {
+      constexpr char new_line = '\n';
+      auto first = source.data();
+      auto last = first + source.size();
+      line_starts.push_back(0);
+      for (auto found = char_scan::find(first, last, new_line); found != last;
+           found = char_scan::find(found + 1, last, new_line)) {
+        line_starts.push_back(static_cast<std::uint32_t>(found + 1 - first));
+      }
+    }
+
+    auto next_line = std::upper_bound(line_starts.begin(), line_starts.end(),
+                                      processed_till);
+    return std::distance(line_starts.begin(), next_line) - 1;
+  }
 
  public:
   // Constructor
   Source(std::string_view source, std::string_view name)
-      : source{source}, name{name} {}
+      : Source{std::make_shared<const std::string>(source), name} {}
+
+  Source(std::shared_ptr<const std::string> source, std::string_view name)
+      : storage{source}, source{*source}, name{name} {}
+
+  /**
+   * View a source whose memory is owned by storage
+   */
+  Source(std::shared_ptr<const void> storage, std::string_view source,
+         std::string_view name)
+      : storage{std::move(storage)}, source{source}, name{name} {}
 
   // Methods
 
@@ -37,27 +84,29 @@ class Source {
 
   auto end() const { return source.cend(); }
 
-  auto get_row() const { return rows_processed; }
+  /**
+   * The row of the first unprocessed character, from 1
+   */
+  std::uint16_t get_row() const {
+    return static_cast<std::uint16_t>(current_line() + 1);
+  }
 
-  auto get_column() const { return column; }
+  /**
+   * The column of the first unprocessed character, from 1
+   */
+  std::uint16_t get_column() const {
+    auto line = current_line();
+    return static_cast<std::uint16_t>(processed_till - line_starts[line] + 1);
+  }
 
   /**
    * Advances for num_characters
    * marks the number of characters as processed
    */
-  void advance(std::size_t num_characters) {
-    constexpr char new_line = '\n';
-    auto from = begin();
-    auto to = from + num_characters;
-    rows_processed += std::count(from, to, new_line);
-
-    auto r_to = std::make_reverse_iterator(from);
-    auto r_from = std::make_reverse_iterator(to);
-    column = std::distance(r_from, std::find(r_from, r_to, new_line)) + 1;
-
-    processed_till += num_characters;
-  }
+  void advance(std::size_t num_characters) { processed_till += num_characters; }
 
   auto& get_name() { return name; }
+
+  std::uint64_t get_id() const { return id; }
 };
 #endif  //! SOURCE_H
@@ -3,9 +3,16 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include <mapped_file.hpp>
+#include <output_sink.hpp>
 #include <source.hpp>
+#include <trace.hpp>
 
 namespace fs = std::filesystem;
 
@@ -15,7 +22,7 @@ namespace source {
  * Check if the output file parent dir exists
  * and create it if it doesn't
  */
-void check_out_dir(fs::path out) {
+inline void check_out_dir(fs::path out) {
   if (!out.has_parent_path()) {
     return;
   }
@@ -27,10 +34,30 @@ void check_out_dir(fs::path out) {
   }
 }
 
+/**
+ * Write the content to the file at path unless it already has that exact
+ * content, so an unchanged output keeps its modification time
+ *
+ * Returns true if the file was written
+ */
+inline bool write_if_changed(fs::path const& path, std::string_view content) {
+  if (auto mapped = MappedFile::open(path); mapped) {
+    if (mapped->view() == content) {
+      return false;
+    }
+  } else if (content.empty() && fs::exists(path) && fs::is_empty(path)) {
+    return false;
+  }
+
+  OutputSink out{path};
+  out.write(content);
+  return out.commit();
+}
+
 /**
  * Check if include is from the standard library
  */
-bool is_standard(std::string_view out) {
+inline bool is_standard(std::string_view out) {
   // FIXME: for now just check if it contains a .
   return out.find('.') == std::string_view::npos;
 }
@@ -38,7 +65,7 @@ bool is_standard(std::string_view out) {
 /**
  * Check if file is a source or a header
  */
-bool is_source(std::string_view name) {
+inline bool is_source(std::string_view name) {
   // FIXME: for now just check the extension to not start with .h
   return name.find(".h") == std::string_view::npos;
 }
@@ -46,7 +73,7 @@ bool is_source(std::string_view name) {
 /**
  * Return the filename part of the path
  */
-std::string get_source_name(fs::path source_path) {
+inline std::string get_source_name(fs::path source_path) {
   return source_path.filename().string();
 }
 
@@ -61,7 +88,7 @@ class SourceLoader {
   SourceLoader(SourceLoader&& s)
       : include_dirs{std::move(s.include_dirs)}, out{std::move(s.out)} {}
 
-  std::optional<fs::path> find_source(fs::path in) {
+  std::optional<fs::path> find_source(fs::path in) const {
     for (auto& dir : include_dirs) {
       auto source = dir / in;
 
@@ -73,26 +100,46 @@ class SourceLoader {
     return std::nullopt;
   }
 
-  fs::path get_out_path(fs::path in) { return out / in; }
+  fs::path get_out_path(fs::path in) const { return out / in; }
 
   auto open_source(fs::path path) {
     auto out_path = out / path;
     check_out_dir(out_path);
     std::cout << "will be writen to " << out_path << std::endl;
-    return std::ofstream(out_path.c_str(), std::ios::out);
+    return OutputSink{out_path};
+  }
+
+  /**
+   * Load the source by mapping it into memory, falls back to read_source
+   * for files that can't be mapped e.g. pipes and stdin
+   */
+  Source load_source(fs::path in) const {
+    trace::Span traced{"io", "load_source", in};
+    if (auto mapped = MappedFile::open(in)) {
+      auto file = std::make_shared<const MappedFile>(std::move(*mapped));
+      auto content = file->view();
+      return {std::move(file), content, in.string()};
+    }
+
+    return read_source(in);
   }
 
-  Source load_source(fs::path in) {
+  /**
+   * Load the source by copying the entire file into memory
+   *
+   * Terminates if the file can't be opened
+   */
+  Source read_source(fs::path in) const {
     std::ifstream in_file(in.c_str());
     if (!in_file.is_open()) {
       std::cerr << in << " file can't be oppened" << std::endl;
       std::terminate();
     }
 
-    // TODO: for now load the entire file, make it better later
-    return {std::string((std::istreambuf_iterator<char>(in_file)),
-                        (std::istreambuf_iterator<char>())),
-            in.string()};
+    auto content = std::make_shared<const std::string>(
+        (std::istreambuf_iterator<char>(in_file)),
+        (std::istreambuf_iterator<char>()));
+    return {std::move(content), in.string()};
   }
 };
 
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
@@ -12,6 +13,8 @@
 
 #include <boost/fusion/include/adapt_struct.hpp>
 
+#include <symbol_table.hpp>
+
 namespace std_parser::rules::ast {
 
 struct SourceLocation {
@@ -19,7 +22,8 @@ struct SourceLocation {
   uint16_t col = 0;
 };
 
-using Type_ = std::vector<std::string>;
+// the :: separated parts of a qualified name
+using Type_ = std::vector<symbols::Symbol>;
 
 struct Type;
 
@@ -218,7 +222,9 @@ struct VariableExpression {
            expression.template_types.template_types.empty();
   }
 
-  std::string const& get_single_name() const { return expression.name.front(); }
+  std::string const& get_single_name() const {
+    return expression.name.front().str();
+  }
 };
 
 struct LiteralExpression {
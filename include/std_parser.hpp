@@ -1,61 +1,130 @@
 #ifndef STD_PARSER_H
 #define STD_PARSER_H
 
+#include <algorithm>
 #include <any>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <optional>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_set>
 #include <variant>
 
+#include <boost/fusion/include/at_c.hpp>
+
+#include <char_scan.hpp>
 #include <detect.hpp>
+#include <lexer.hpp>
+#include <node_store.hpp>
 #include <overloaded.hpp>
 #include <result.hpp>
 #include <std_rules.hpp>
 #include <string_utils.hpp>
+#include <trace.hpp>
 
 namespace std_parser {
-using CodeFragment =
-    std::variant<rules::ast::Namespace, rules::ast::Scope, rules::ast::Class,
-                 rules::ast::Enumeration, rules::ast::Function,
-                 rules::ast::Vars, rules::ast::Expression, rules::ast::Lambda,
-                 rules::ast::RoundExpression, rules::ast::CurlyExpression,
-                 rules::ast::Statement, rules::ast::ReturnStatement,
-                 rules::ast::IfExpression>;
+template <template <class...> class T>
+using WithCodeFragments =
+    T<rules::ast::Namespace, rules::ast::Scope, rules::ast::Class,
+      rules::ast::Enumeration, rules::ast::Function, rules::ast::Vars,
+      rules::ast::Expression, rules::ast::Lambda, rules::ast::RoundExpression,
+      rules::ast::CurlyExpression, rules::ast::Statement,
+      rules::ast::ReturnStatement, rules::ast::IfExpression>;
+
+using CodeFragment = WithCodeFragments<std::variant>;
+
+using CodeFragmentStore = WithCodeFragments<node_store::NodeStore>;
+using CodeFragmentHandle = CodeFragmentStore::handle_type;
 
 class StdParserState {
-  class {
-    std::vector<CodeFragment> code_fragments = {rules::ast::Namespace{""}};
-    rules::ast::SourceLocation current_location = {0, 0};
+  class AstState {
+    // the code fragments being parsed, from the top namespace to the current
+    CodeFragmentStore code_fragments;
+    // the source of the statement being parsed, it is only asked for a
+    // location when a node is added
+    void* source = nullptr;
+    rules::ast::SourceLocation (*locate)(void* source) = nullptr;
 
    public:
-    void set_location(rules::ast::SourceLocation l) { current_location = l; }
+    using Handle = CodeFragmentHandle;
+
+    AstState() { code_fragments.push(rules::ast::Namespace{""}); }
+
+    /**
+     * The nodes added from now on are located at the start of the source
+     */
+    template <class Source>
+    void set_source(Source& s) {
+      source = &s;
+      locate = [](void* erased) {
+        auto& typed = *static_cast<Source*>(erased);
+        return rules::ast::SourceLocation{typed.get_row(), typed.get_column()};
+      };
+    }
 
     auto size() const { return code_fragments.size(); }
 
-    auto& get_code_fragments() { return code_fragments; }
+    auto const& get_handles() const { return code_fragments.get_handles(); }
 
-    auto const& get_code_fragments() const { return code_fragments; }
+    template <class Fragment>
+    void emplace_back(Fragment&& f) {
+      if constexpr (CodeFragmentStore::can_store<std::decay_t<Fragment>>) {
+        code_fragments.push(std::forward<Fragment>(f)).loc = get_location();
+      } else {
+        // e.g. a VariableExpression opens an Expression
+        emplace_back(CodeFragment{std::forward<Fragment>(f)});
+      }
+    }
 
-    // TODO: maybe do a real emplace_back but watch out for implicit conversions
     void emplace_back(CodeFragment&& cf) {
-      std::visit([this](auto& f) { f.loc = current_location; }, cf);
-      code_fragments.emplace_back(std::move(cf));
+      std::visit([this](auto& f) { emplace_back(std::move(f)); }, cf);
     }
 
-    void push_back(CodeFragment&& cf) {
-      std::visit([this](auto& f) { f.loc = current_location; }, cf);
-      code_fragments.emplace_back(std::move(cf));
+    template <class Fragment>
+    void push_back(Fragment&& f) {
+      emplace_back(std::forward<Fragment>(f));
     }
 
-    void pop_back() { code_fragments.pop_back(); }
+    void pop_back() { code_fragments.pop(); }
 
-    auto& front() { return code_fragments.front(); }
+    Handle front() const { return code_fragments.front(); }
 
-    auto& back() { return code_fragments.back(); }
+    Handle back() const { return code_fragments.back(); }
 
-    auto get_location() const { return current_location; }
+    rules::ast::SourceLocation get_location() const {
+      return locate != nullptr ? locate(source) : rules::ast::SourceLocation{};
+    }
+
+    Handle operator[](std::size_t i) const { return code_fragments[i]; }
+
+    template <class Fragment>
+    Fragment& get(Handle h) {
+      return code_fragments.template get<Fragment>(h);
+    }
+
+    template <class Fragment>
+    Fragment const& get(Handle h) const {
+      return code_fragments.template get<Fragment>(h);
+    }
 
-    auto& operator[](std::size_t i) { return code_fragments[i]; }
+    template <class F>
+    decltype(auto) visit(F&& f, Handle h) {
+      return code_fragments.visit(std::forward<F>(f), h);
+    }
+
+    /**
+     * Drop everything but a new top namespace, the capacity is kept for the
+     * next file
+     */
+    void reset() {
+      code_fragments.clear();
+      code_fragments.push(rules::ast::Namespace{""});
+      source = nullptr;
+      locate = nullptr;
+    }
   } ast_state;
 
   // TODO: includes should be merged with CodeFragment
@@ -66,25 +135,250 @@ class StdParserState {
   // until we can recreate the body from our AST
   std::vector<std::any> function_begins;
 
+  // the results of the memoized rules in the file being parsed, kept from one
+  // statement to the next as the positions stay valid until the file is done
+  memo::MemoTable memo_table;
+  bool memoize = true;
+  // the tokens of the file being parsed
+  lexer::TokenStream tokens;
+  bool tokenize = true;
+  // the source the table and the tokens belong to, its id if it has one, the
+  // character it was prepared from and its last character
+  std::uint64_t source_id = 0;
+  const char* source_begin = nullptr;
+  const void* source_back = nullptr;
+
   // parser methods
 
+  /**
+   * x3::parse with the memo table in the context of the rules
+   */
+  template <class Iter, class Parser>
+  bool try_parse(Iter& begin, Iter end, Parser const& parser) {
+    namespace x3 = boost::spirit::x3;
+    return x3::parse(begin, end,
+                     x3::with<memo::memo_tag>(memoize ? &memo_table
+                                                      : nullptr)[parser]);
+  }
+
+  template <class T>
+  using source_id_fun = decltype(std::declval<T const&>().get_id());
+
+  /**
+   * Tokenize the source and clear the memo table if the source isn't the one
+   * they were made from, for users that parse different sources without a
+   * reset in between
+   *
+   * A source is the same if it has the same id and the same last character.
+   * Sources without an id are prepared again whenever a parse starts at their
+   * first character, a new text read into the memory of the last one may have
+   * the same last character
+   *
+   * The memo table is also cleared if it grew past what fits in the cache.
+   * The parsed statements are never parsed again, most of a big table is
+   * results nobody will look up
+   */
   template <class Source>
-  auto parse_inside_namespace(Source& source, rules::ast::Namespace& current) {
+  void prepare_source(Source& source) {
     auto begin = source.begin();
     auto end = source.end();
+    if (begin == end) {
+      return;
+    }
 
-    auto nest = [this](auto& ctx) {
-      auto& rez = _attr(ctx);
-      ast_state.emplace_back(std::move(rez));
+    std::uint64_t id = 0;
+    if constexpr (is_detected_v<source_id_fun, Source>) {
+      id = source.get_id();
+    }
+    const char* first = &*begin;
+    const void* back = std::addressof(*std::prev(end));
+    if (id != source_id || back != source_back ||
+        (id == 0 && first == source_begin)) {
+      if (tokenize) {
+        tokens.tokenize(first, first + std::distance(begin, end));
+      }
+      memo_table.clear();
+      source_id = id;
+      source_begin = first;
+      source_back = back;
+    } else if (memo_table.size() > 1024) {
+      memo_table.clear();
+    }
+  }
+
+  /**
+   * Parse the spaces and comments at the start of the source as one
+   * statement, from the tokens without the rules
+   */
+  template <class Source>
+  auto parse_blank(Source& source) {
+    auto begin = source.begin();
+    if (begin != source.end()) {
+      const char* position = &*begin;
+      std::advance(begin, tokens.skip_blank(position) - position);
+    }
+
+    return begin != source.begin()
+               ? std::optional{Result{
+                     begin, make_string_view(source.begin(), begin)}}
+               : std::nullopt;
+  }
+
+  /**
+   * What the source starts with, it selects the rules that can match there
+   */
+  enum class FirstToken {
+    Space,
+    Hash,
+    Slash,
+    ScopeEnd,
+    // class, struct or template
+    ClassKey,
+    Enum,
+    Namespace,
+    AccessModifier,
+    Identifier,
+    Other
+  };
+
+  /**
+   * The kind of the token at the start of the source, its name is compared to
+   * the keywords
+   */
+  FirstToken first_token(lexer::Token const& token) {
+    using lexer::TokenKind;
+    using namespace std::string_view_literals;
+    static constexpr std::string_view class_key[] = {"class", "struct",
+                                                     "template"};
+    static constexpr std::string_view access[] = {"public", "protected",
+                                                  "private"};
+
+    switch (token.kind) {
+      case TokenKind::Space:
+        return FirstToken::Space;
+      case TokenKind::LineComment:
+      case TokenKind::BlockComment:
+        return FirstToken::Slash;
+      case TokenKind::Identifier:
+        break;
+      default:
+        return FirstToken::Other;
+    }
+
+    auto name = tokens.get_text(token);
+    auto is_one_of = [name](auto& keywords) {
+      return std::find(std::begin(keywords), std::end(keywords), name) !=
+             std::end(keywords);
     };
+    if (is_one_of(class_key)) {
+      return FirstToken::ClassKey;
+    }
+    if (name == "enum"sv) {
+      return FirstToken::Enum;
+    }
+    if (name == "namespace"sv) {
+      return FirstToken::Namespace;
+    }
+    if (is_one_of(access)) {
+      return FirstToken::AccessModifier;
+    }
 
-    auto fun = [this, &begin](auto& ctx) {
-      auto& rez = _attr(ctx);
+    return FirstToken::Identifier;
+  }
+
+  /**
+   * What the source starts with, from its token if one starts there
+   */
+  template <class Iter>
+  FirstToken first_token(Iter begin, Iter end) {
+    if (begin == end) {
+      return FirstToken::Other;
+    }
+
+    auto lexed = tokens.at(&*begin);
+    if (lexed != nullptr && lexed->kind != lexer::TokenKind::Punctuation) {
+      return first_token(*lexed);
+    }
+
+    switch (*begin) {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        return FirstToken::Space;
+      case '#':
+        return FirstToken::Hash;
+      case '/':
+        return FirstToken::Slash;
+      case '}':
+        return FirstToken::ScopeEnd;
+      default:
+        break;
+    }
+
+    auto is_name_start = [](unsigned char c) {
+      return std::isalpha(c) || c == '_';
+    };
+    if (!is_name_start(*begin)) {
+      return FirstToken::Other;
+    }
+
+    auto token_end = std::find_if_not(begin, end, [](unsigned char c) {
+      return std::isalnum(c) || c == '_';
+    });
+    std::string_view token{&*begin,
+                           static_cast<std::size_t>(token_end - begin)};
+    if (token == "class" || token == "struct" || token == "template") {
+      return FirstToken::ClassKey;
+    }
+    if (token == "enum") {
+      return FirstToken::Enum;
+    }
+    if (token == "namespace") {
+      return FirstToken::Namespace;
+    }
+    if (token == "public" || token == "protected" || token == "private") {
+      return FirstToken::AccessModifier;
+    }
+
+    return FirstToken::Identifier;
+  }
+
+  /**
+   * Parse the declaration once and branch on what ends it, open is called
+   * with its attribute on a scope_begin and declare on a statement_end
+   */
+  template <class Declaration, class Open, class Declare>
+  static auto open_or_declare(Declaration const& declaration, Open open,
+                              Declare declare) {
+    auto branch = [open, declare](auto& ctx) mutable {
+      auto& rez = boost::fusion::at_c<0>(_attr(ctx));
+      if (boost::fusion::at_c<1>(_attr(ctx))) {
+        open(rez);
+      } else {
+        declare(rez);
+      }
+    };
+
+    return (declaration >> rules::opens_scope)[branch];
+  }
+
+  template <class Source>
+  auto parse_inside_namespace(Source& source, rules::ast::Namespace& current) {
+    auto begin = source.begin();
+    auto end = source.end();
+
+    // nest, fun and declared get the attribute of a declaration
+    auto nest = [this](auto& rez) { ast_state.emplace_back(std::move(rez)); };
+
+    auto fun = [this, &begin](auto& rez) {
       // TODO: we can get begin from the context
       function_begins.push_back(begin);
       ast_state.emplace_back(std::move(rez));
     };
 
+    auto declared = [](auto&) {};
+
     auto var = [this](auto& ctx) {
       auto& rez = _attr(ctx);
       ast_state.emplace_back(rules::ast::Statement{});
@@ -107,8 +401,8 @@ class StdParserState {
         throw std::runtime_error("extraneous closing brace ('}')");
       }
 
-      auto& v = ast_state[ast_state.size() - 2];
-      std::visit(
+      auto v = ast_state[ast_state.size() - 2];
+      ast_state.visit(
           overloaded{
               [&](rules::ast::Namespace& arg) {
                 arg.add_namespace(std::move(current));
@@ -123,22 +417,56 @@ class StdParserState {
     };
 
     namespace x3 = boost::spirit::x3;
-    bool parsed =
-        x3::parse(begin, end,
-                  // rules begin
-                  rules::some_space |
-                      ((rules::class_or_struct >> rules::scope_begin)[nest] |
-                       (rules::class_or_struct >> rules::statement_end) |
-                       (rules::function_signiture >> rules::scope_begin)[fun] |
-                       (rules::function_signiture >> rules::statement_end) |
-                       (rules::operator_signiture >> rules::scope_begin)[fun] |
-                       (rules::operator_signiture >> rules::statement_end) |
-                       (rules::enumeration >> rules::scope_begin)[nest] |
-                       (rules::enumeration >> rules::statement_end) |
-                       rules::namespace_begin[sb] | rules::scope_end[se] |
-                       rules::include[inc] | rules::comment | rules::param[var])
-                  // rules end
+    auto classes = open_or_declare(rules::class_or_struct, nest, declared);
+    auto functions = open_or_declare(rules::function_signiture, fun, declared);
+    auto operators = open_or_declare(rules::operator_signiture, fun, declared);
+    auto enums = open_or_declare(rules::enumeration, nest, declared);
+
+    // only the rules that can start with the first token are tried, in the
+    // same order as in the full list
+    bool parsed;
+    switch (first_token(begin, end)) {
+      case FirstToken::Space:
+        parsed = try_parse(begin, end, rules::some_space);
+        break;
+      case FirstToken::Hash:
+        parsed = try_parse(begin, end, rules::include[inc]);
+        break;
+      case FirstToken::Slash:
+        parsed = try_parse(begin, end, rules::comment);
+        break;
+      case FirstToken::ScopeEnd:
+        parsed = try_parse(begin, end, rules::scope_end[se]);
+        break;
+      case FirstToken::ClassKey:
+        parsed = try_parse(begin, end,
+                           classes | functions | operators | rules::param[var]);
+        break;
+      case FirstToken::Enum:
+        parsed = try_parse(begin, end,
+                           functions | operators | enums | rules::param[var]);
+        break;
+      case FirstToken::Namespace:
+        parsed = try_parse(begin, end,
+                           functions | operators | rules::namespace_begin[sb] |
+                               rules::param[var]);
+        break;
+      case FirstToken::AccessModifier:
+      case FirstToken::Identifier:
+        parsed =
+            try_parse(begin, end, functions | operators | rules::param[var]);
+        break;
+      default:
+        parsed = try_parse(begin, end,
+                           // rules begin
+                           rules::some_space |
+                               (classes | functions | operators | enums |
+                                rules::namespace_begin[sb] |
+                                rules::scope_end[se] | rules::include[inc] |
+                                rules::comment | rules::param[var])
+                           // rules end
         );
+    }
 
     return parsed ? std::optional{Result{
                         begin, make_string_view(source.begin(), begin)}}
@@ -150,24 +478,22 @@ class StdParserState {
     auto begin = source.begin();
     auto end = source.end();
 
-    auto nest = [this](auto& ctx) {
-      auto& rez = _attr(ctx);
-      ast_state.emplace_back(std::move(rez));
-    };
+    // nest, fun, funSig and declared get the attribute of a declaration
+    auto nest = [this](auto& rez) { ast_state.emplace_back(std::move(rez)); };
 
-    auto fun = [this, &begin](auto& ctx) {
-      auto& rez = _attr(ctx);
+    auto fun = [this, &begin](auto& rez) {
       // TODO: we can get begin from the context
       function_begins.push_back(begin);
       ast_state.emplace_back(std::move(rez));
     };
 
-    auto funSig = [&](auto& ctx) {
-      auto& rez = _attr(ctx);
+    auto funSig = [&](auto& rez) {
       rez.loc = ast_state.get_location();
       current.add_function(std::move(rez));
     };
 
+    auto declared = [](auto&) {};
+
     auto ac = [&](auto& ctx) {
       auto& rez = _attr(ctx);
       current.set_access_modifier(rez);
@@ -187,24 +513,61 @@ class StdParserState {
     auto se = [&](auto&) { this->close_code_fragment<rules::ast::Class>(); };
 
     namespace x3 = boost::spirit::x3;
-    bool parsed = x3::parse(
-        begin, end,
-        // rules begin
-        rules::some_space |
-            ((rules::class_or_struct >> rules::scope_begin)[nest] |
-             (rules::class_or_struct >> rules::statement_end) |
-             (rules::method_signiture >> rules::scope_begin)[fun] |
-             (rules::method_signiture >> rules::statement_end)[funSig] |
-             (rules::operator_signiture >> rules::scope_begin)[fun] |
-             (rules::operator_signiture >> rules::statement_end)[funSig] |
-             (rules::constructor >> rules::scope_begin)[fun] |
-             (rules::constructor >> rules::statement_end)[funSig] |
-             (rules::enumeration >> rules::scope_begin)[nest] |
-             (rules::enumeration >> rules::statement_end) |
-             rules::scope_end[se] | rules::include[inc] | rules::comment |
-             rules::class_access_modifier[ac] | rules::param[var])
-        // rules end
-    );
+    auto classes = open_or_declare(rules::class_or_struct, nest, declared);
+    auto methods = open_or_declare(rules::method_signiture, fun, funSig);
+    auto operators = open_or_declare(rules::operator_signiture, fun, funSig);
+    auto constructors = open_or_declare(rules::constructor, fun, funSig);
+    auto enums = open_or_declare(rules::enumeration, nest, declared);
+
+    // only the rules that can start with the first token are tried, in the
+    // same order as in the full list
+    bool parsed;
+    switch (first_token(begin, end)) {
+      case FirstToken::Space:
+        parsed = try_parse(begin, end, rules::some_space);
+        break;
+      case FirstToken::Hash:
+        parsed = try_parse(begin, end, rules::include[inc]);
+        break;
+      case FirstToken::Slash:
+        parsed = try_parse(begin, end, rules::comment);
+        break;
+      case FirstToken::ScopeEnd:
+        parsed = try_parse(begin, end, rules::scope_end[se]);
+        break;
+      case FirstToken::ClassKey:
+        parsed = try_parse(begin, end,
+                           classes | methods | operators | constructors |
+                               rules::param[var]);
+        break;
+      case FirstToken::Enum:
+        parsed = try_parse(begin, end,
+                           methods | operators | constructors | enums |
+                               rules::param[var]);
+        break;
+      case FirstToken::AccessModifier:
+        parsed = try_parse(begin, end,
+                           methods | operators | constructors |
+                               rules::class_access_modifier[ac] |
+                               rules::param[var]);
+        break;
+      case FirstToken::Namespace:
+      case FirstToken::Identifier:
+        parsed = try_parse(begin, end,
+                           methods | operators | constructors |
+                               rules::param[var]);
+        break;
+      default:
+        parsed = try_parse(
+            begin, end,
+            // rules begin
+            rules::some_space |
+                (classes | methods | operators | constructors | enums |
+                 rules::scope_end[se] | rules::include[inc] | rules::comment |
+                 rules::class_access_modifier[ac] | rules::param[var])
+            // rules end
+        );
+    }
 
     return parsed ? std::optional{Result{
                         begin, make_string_view(source.begin(), begin)}}
@@ -226,7 +589,7 @@ class StdParserState {
     };
 
     namespace x3 = boost::spirit::x3;
-    bool parsed = x3::parse(
+    bool parsed = try_parse(
         begin, end,
         // rules begin
         rules::optionaly_space >>
@@ -267,14 +630,14 @@ class StdParserState {
     namespace x3 = boost::spirit::x3;
     bool parsed = false;
     if (current.is_begin()) {
-      parsed = x3::parse(
+      parsed = try_parse(
           begin, end,
           // rules begin
           rules::optionaly_space >> (rules::comment | rules::expression[exp])
           // rules end
       );
     } else {
-      parsed = x3::parse(
+      parsed = try_parse(
           begin, end,
           // rules begin
           rules::optionaly_space >> (rules::comment | rules::operator_sep[beg])
@@ -324,7 +687,7 @@ class StdParserState {
     namespace x3 = boost::spirit::x3;
     bool parsed = false;
     if (current.is_begin()) {
-      parsed = x3::parse(begin, end,
+      parsed = try_parse(begin, end,
                          // rules begin
                          rules::optionaly_space >>
                              (rules::comment | rules::parenthesis_end[se] |
@@ -332,7 +695,7 @@ class StdParserState {
                          // rules end
       );
     } else {
-      parsed = x3::parse(begin, end,
+      parsed = try_parse(begin, end,
                          // rules begin
                          rules::optionaly_space >>
                              (rules::comment | rules::parenthesis_end[se] |
@@ -383,7 +746,7 @@ class StdParserState {
     namespace x3 = boost::spirit::x3;
     bool parsed = false;
     if (current.is_begin()) {
-      parsed = x3::parse(begin, end,
+      parsed = try_parse(begin, end,
                          // rules begin
                          rules::optionaly_space >>
                              (rules::comment | rules::curly_begin[nest] |
@@ -391,7 +754,7 @@ class StdParserState {
                          // rules end
       );
     } else {
-      parsed = x3::parse(
+      parsed = try_parse(
           begin, end,
           // rules begin
           rules::optionaly_space >>
@@ -446,7 +809,7 @@ class StdParserState {
 
     namespace x3 = boost::spirit::x3;
     bool parsed =
-        x3::parse(begin, end,
+        try_parse(begin, end,
                   // rules begin
                   rules::some_space |
                       ((rules::class_or_struct >> rules::scope_begin)[nest] |
@@ -494,7 +857,7 @@ class StdParserState {
     bool parsed = false;
     switch (current.state) {
       case rules::ast::IfExpressionState::Begin:
-        parsed = x3::parse(begin, end,
+        parsed = try_parse(begin, end,
                            // rules begin
                            '(' >> rules::optionaly_space >>
                                (rules::comment | rules::var_with_init[var] |
@@ -503,7 +866,7 @@ class StdParserState {
         );
         break;
       case rules::ast::IfExpressionState::Expression:
-        parsed = x3::parse(
+        parsed = try_parse(
             begin, end,
             // rules begin
             rules::optionaly_space >>
@@ -514,7 +877,7 @@ class StdParserState {
         break;
       case rules::ast::IfExpressionState::Done:
         parsed =
-            x3::parse(begin, end,
+            try_parse(begin, end,
                       // rules begin
                       rules::optionaly_space >> rules::parenthesis_end[close]
                       // rules end
@@ -535,7 +898,7 @@ class StdParserState {
     auto se = [this](auto&) { close_code_fragment<Statement>(); };
 
     namespace x3 = boost::spirit::x3;
-    bool parsed = x3::parse(begin, end,
+    bool parsed = try_parse(begin, end,
                             // rules begin
                             rules::optionaly_space >> rules::statement_end[se]
                             // rules end
@@ -573,7 +936,7 @@ class StdParserState {
 
     switch (current.state) {
       case rules::ast::VarDefinition::Init:
-        parsed = x3::parse(
+        parsed = try_parse(
             begin, end,
             // rules begin
             rules::optionaly_space >>
@@ -587,7 +950,7 @@ class StdParserState {
         break;
       case rules::ast::VarDefinition::Next:
         parsed =
-            x3::parse(begin, end,
+            try_parse(begin, end,
                       // rules begin
                       rules::optionaly_space >>
                           (rules::comment |
@@ -663,8 +1026,8 @@ class StdParserState {
       auto end = source.begin();
       auto start = std::any_cast<decltype(end)>(current_functions_start);
       current.body = std::string(start, end) + '\n';
-      auto& v = ast_state[ast_state.size() - 2];
-      std::visit(
+      auto v = ast_state[ast_state.size() - 2];
+      ast_state.visit(
           overloaded{
               [&](rules::ast::Namespace& arg) {
                 arg.add_function(std::move(current));
@@ -684,7 +1047,7 @@ class StdParserState {
 
     namespace x3 = boost::spirit::x3;
     bool parsed =
-        x3::parse(begin, end,
+        try_parse(begin, end,
                   // rules begin
                   rules::some_space |
                       ((rules::class_or_struct >> rules::scope_begin)[nest] |
@@ -746,7 +1109,7 @@ class StdParserState {
 
     namespace x3 = boost::spirit::x3;
     bool parsed =
-        x3::parse(begin, end,
+        try_parse(begin, end,
                   // rules begin
                   rules::some_space |
                       ((rules::class_or_struct >> rules::scope_begin)[nest] |
@@ -768,9 +1131,9 @@ class StdParserState {
   }
 
   void close_current_class() {
-    auto& c = std::get<rules::ast::Class>(ast_state.back());
-    auto& v = ast_state[ast_state.size() - 2];
-    std::visit(
+    auto& c = ast_state.get<rules::ast::Class>(ast_state.back());
+    auto v = ast_state[ast_state.size() - 2];
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Namespace& arg) { arg.add_class(std::move(c)); },
             [&](rules::ast::Class& arg) { arg.add_class(std::move(c)); },
@@ -782,9 +1145,9 @@ class StdParserState {
   }
 
   void close_current_enum() {
-    auto& c = std::get<rules::ast::Enumeration>(ast_state.back());
-    auto& v = ast_state[ast_state.size() - 2];
-    std::visit(
+    auto& c = ast_state.get<rules::ast::Enumeration>(ast_state.back());
+    auto v = ast_state[ast_state.size() - 2];
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Namespace& arg) { arg.add_enum(std::move(c)); },
             [&](rules::ast::Class& arg) { arg.add_enum(std::move(c)); },
@@ -796,9 +1159,9 @@ class StdParserState {
   }
 
   void close_current_var_declaration() {
-    auto& c = std::get<rules::ast::Vars>(ast_state.back());
-    auto& v = ast_state[ast_state.size() - 2];
-    std::visit(
+    auto& c = ast_state.get<rules::ast::Vars>(ast_state.back());
+    auto v = ast_state[ast_state.size() - 2];
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Class& arg) { arg.add_variables(c.variables); },
             [&](rules::ast::Namespace& arg) { arg.add_variables(c.variables); },
@@ -816,9 +1179,9 @@ class StdParserState {
   }
 
   void close_current_scope() {
-    auto& c = std::get<rules::ast::Scope>(ast_state.back());
-    auto& v = ast_state[ast_state.size() - 2];
-    std::visit(
+    auto& c = ast_state.get<rules::ast::Scope>(ast_state.back());
+    auto v = ast_state[ast_state.size() - 2];
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Function& arg) {
               arg.statements.emplace_back(std::move(c));
@@ -834,8 +1197,8 @@ class StdParserState {
   }
 
   template <class Expression>
-  void move_expression(CodeFragment& cf, Expression&& e) {
-    std::visit(
+  void move_expression(CodeFragmentHandle cf, Expression&& e) {
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Expression& arg) {
               arg.expressions.emplace_back(std::move(e));
@@ -861,15 +1224,15 @@ class StdParserState {
 
   template <class Expression>
   void close_current_expression() {
-    auto& expression = std::get<Expression>(ast_state.back());
-    auto& variant_code_fragment = ast_state[ast_state.size() - 2];
+    auto& expression = ast_state.get<Expression>(ast_state.back());
+    auto variant_code_fragment = ast_state[ast_state.size() - 2];
     move_expression(variant_code_fragment, expression);
   }
 
   void close_current_expression() {
-    auto& expression = std::get<rules::ast::Expression>(ast_state.back());
-    auto& variant_code_fragment = ast_state[ast_state.size() - 2];
-    std::visit(
+    auto& expression = ast_state.get<rules::ast::Expression>(ast_state.back());
+    auto variant_code_fragment = ast_state[ast_state.size() - 2];
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Statement& arg) {
               arg.expression = std::move(expression);
@@ -889,9 +1252,9 @@ class StdParserState {
 
   template <class Statement>
   void close_current_statement() {
-    auto& statement = std::get<Statement>(ast_state.back());
-    auto& variant_code_fragment = ast_state[ast_state.size() - 2];
-    std::visit(
+    auto& statement = ast_state.get<Statement>(ast_state.back());
+    auto variant_code_fragment = ast_state[ast_state.size() - 2];
+    ast_state.visit(
         overloaded{
             [&](rules::ast::Function& arg) {
               arg.statements.emplace_back(std::move(statement));
@@ -922,10 +1285,21 @@ class StdParserState {
    */
   template <class Source>
   std::optional<Result<Iter<Source>, std::string_view>> parse(Source& source) {
-    ast_state.set_location({source.get_row(), source.get_column()});
+    ast_state.set_source(source);
+    prepare_source(source);
+
+    auto current_code_fragment = ast_state.back();
+    // the spaces and comments between declarations and statements
+    if (current_code_fragment.is<rules::ast::Namespace>() ||
+        current_code_fragment.is<rules::ast::Class>() ||
+        current_code_fragment.is<rules::ast::Function>() ||
+        current_code_fragment.is<rules::ast::Scope>()) {
+      if (auto blank = parse_blank(source)) {
+        return blank;
+      }
+    }
 
-    auto& current_code_fragment = ast_state.back();
-    return std::visit(
+    return ast_state.visit(
         overloaded{[&](rules::ast::Namespace& arg) {
                      return parse_inside_namespace(source, arg);
                    },
@@ -977,16 +1351,34 @@ class StdParserState {
   }
 
   /**
-   * Return a constant view of all the code_fragments
+   * Return a constant view of the handles of all the code_fragments
    */
-  auto const& get_all_code_fragments() const {
-    return ast_state.get_code_fragments();
+  auto const& get_all_code_fragments() const { return ast_state.get_handles(); }
+
+  CodeFragmentHandle get_current_code_fragment() const {
+    return ast_state.back();
+  }
+
+  template <class Fragment>
+  Fragment& get_code_fragment(CodeFragmentHandle h) {
+    return ast_state.get<Fragment>(h);
   }
 
-  CodeFragment& get_current_code_fragment() { return ast_state.back(); }
+  template <class Fragment>
+  Fragment const& get_code_fragment(CodeFragmentHandle h) const {
+    return ast_state.get<Fragment>(h);
+  }
+
+  /**
+   * Call f with the code_fragment of the handle, like std::visit
+   */
+  template <class F>
+  decltype(auto) visit_code_fragment(F&& f, CodeFragmentHandle h) {
+    return ast_state.visit(std::forward<F>(f), h);
+  }
 
   rules::ast::Namespace const& get_top_code_fragment() {
-    return std::get<rules::ast::Namespace>(ast_state.front());
+    return ast_state.get<rules::ast::Namespace>(ast_state.front());
   }
 
   // TODO add SFINAE for CodeFragment
@@ -1024,45 +1416,104 @@ class StdParserState {
     ast_state.pop_back();
   }
 
+  /**
+   * Return the includes of the source
+   *
+   * Same as parsing the source with some_space | include | skip_line, but the
+   * include rule is only tried on a '#' that is the first non space character
+   * of a line or directly follows a previous include, the rest is skipped by
+   * searching for the '#' and line end characters
+   */
   template <class Source>
   auto get_includes(Source& source) {
-    auto begin = source.begin();
-    auto end = source.end();
+    trace::Span traced{"parse", "get_includes"};
     std::unordered_set<std::string> includes;
+    std::size_t size = std::distance(source.begin(), source.end());
+    if (size == 0) {
+      return includes;
+    }
 
     auto inc = [&includes](auto& ctx) {
       auto& rez = _attr(ctx);
       includes.emplace(std::move(rez));
     };
 
-    while (begin != end) {
-      namespace x3 = boost::spirit::x3;
-      bool parsed =
-          x3::parse(begin, end,
-                    // rules begin
-                    rules::some_space | rules::include[inc] | rules::skip_line
-                    // rules end
-          );
-
-      if (!parsed) {
-        std::size_t remaining = std::distance(begin, end);
-        std::size_t size = std::min<std::size_t>(30ul, remaining);
-        std::string_view content = {&*begin, size};
-
-        std::string error_msg = "source can't be parsed by the std parser: ";
-        error_msg += std::to_string(content.size());
-        error_msg += content;
-        throw std::runtime_error(error_msg);
+    auto is_space = [](char c) { return c == ' ' || c == '\t'; };
+    auto is_eol = [](char c) { return c == '\n' || c == '\r'; };
+
+    // line_begin is where the original loop would start a new iteration
+    const char* line_begin = &*source.begin();
+    const char* end = line_begin + size;
+    while (line_begin != end) {
+      auto hash = char_scan::find(line_begin, end, '#');
+      if (hash == end) {
+        break;
       }
+
+      auto before = hash;
+      while (before != line_begin && is_space(*(before - 1))) {
+        --before;
+      }
+
+      if (before == line_begin || is_eol(*(before - 1))) {
+        namespace x3 = boost::spirit::x3;
+        auto begin = hash;
+        if (x3::parse(begin, end, rules::include[inc])) {
+          line_begin = begin;
+          continue;
+        }
+      }
+
+      // skip the rest of the line
+      line_begin = char_scan::find_eol(hash, end);
     }
 
-    return std::move(includes);
+    return includes;
   }
 
   /**
    * Return all the includes in the parsed file
    */
   auto& get_all_includes() { return includes; }
+
+  /**
+   * Release the AST and the includes of the parsed file in one step and start
+   * over in a new top namespace
+   */
+  void reset() {
+    ast_state.reset();
+    includes.clear();
+    function_begins.clear();
+    memo_table.clear();
+    tokens.clear();
+    source_id = 0;
+    source_begin = nullptr;
+    source_back = nullptr;
+  }
+
+  /**
+   * Parse the recursive types and expressions through a memo table, on by
+   * default. Only worth turning off to measure what it saves
+   */
+  void set_memoization(bool enabled) {
+    memoize = enabled;
+    memo_table.clear();
+  }
+
+  /**
+   * Skip the spaces and comments and select the rules of a statement from the
+   * tokens of the source, on by default. Without them the rules parse the
+   * blanks and the first word is read from the characters. Only worth turning
+   * off to measure what it saves
+   */
+  void set_tokenization(bool enabled) {
+    tokenize = enabled;
+    memo_table.clear();
+    tokens.clear();
+    source_id = 0;
+    source_begin = nullptr;
+    source_back = nullptr;
+  }
 };  // namespace std_parser
 
 class StdParser {
@@ -1201,6 +1652,21 @@ class StdParser {
    */
   auto& get_all_includes() { return parser.get_all_includes(); }
 
+  /**
+   * Release everything parsed so far, called when a file is done
+   */
+  void reset() { parser.reset(); }
+
+  /**
+   * See StdParserState::set_memoization
+   */
+  void set_memoization(bool enabled) { parser.set_memoization(enabled); }
+
+  /**
+   * See StdParserState::set_tokenization
+   */
+  void set_tokenization(bool enabled) { parser.set_tokenization(enabled); }
+
   // ==============
   // CODE FRAGMENTS
   // ==============
@@ -1213,21 +1679,39 @@ class StdParser {
   }
 
   /**
-   * Return a constant view of all the code_fragments
+   * Return a constant view of the handles of all the code_fragments
    */
   auto const& get_all_code_fragments() const {
     return parser.get_all_code_fragments();
   }
 
-  CodeFragment& get_current_code_fragment() {
+  CodeFragmentHandle get_current_code_fragment() const {
     return parser.get_current_code_fragment();
   }
 
+  template <class Fragment>
+  Fragment& get_code_fragment(CodeFragmentHandle h) {
+    return parser.get_code_fragment<Fragment>(h);
+  }
+
+  template <class Fragment>
+  Fragment const& get_code_fragment(CodeFragmentHandle h) const {
+    return parser.get_code_fragment<Fragment>(h);
+  }
+
+  /**
+   * Return the current code_fragment, it must be a Fragment
+   */
+  template <class Fragment>
+  Fragment& get_current_code_fragment() {
+    return get_code_fragment<Fragment>(get_current_code_fragment());
+  }
+
   // TODO: constrain Types as the types in the variant of CodeFragment
   template <class... Types>
-  bool is_current_code_fragment() {
-    auto& current = parser.get_current_code_fragment();
-    return (std::holds_alternative<Types>(current) || ...);
+  bool is_current_code_fragment() const {
+    auto current = parser.get_current_code_fragment();
+    return (current.is<Types>() || ...);
   }
 
   // TODO: Constraint Fragment to CodeFragment
@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include <grammar_profile.hpp>
+#include <memo.hpp>
 #include <std_ast.hpp>
 
 #include <boost/spirit/home/x3.hpp>
@@ -150,6 +152,11 @@ auto const scope_end_def = optionaly_space >> '}' >> optionaly_space >>
 x3::rule<class statement_end> const statement_end = "statement_end";
 auto const statement_end_def = optionaly_space >> ';';
 
+// true if a scope begins after a declaration, false if the statement ends
+x3::rule<class opens_scope, bool> const opens_scope = "opens_scope";
+auto const opens_scope_def = (scope_begin >> x3::attr(true)) |
+                             (statement_end >> x3::attr(false));
+
 x3::rule<class name, std::string> const name = "name";
 auto const name_def = ((alpha | char_('_')) >> *(alpha | digit | char_('_')));
 
@@ -204,8 +211,12 @@ x3::rule<class char_literal, ast::UnqulifiedType> const char_literal =
 auto const char_literal_def = x3::omit[lit('\'') >> (char_ - '\'') >> '\''] >>
                               x3::attr(ast::UnqulifiedType{{"char"}, {}});
 
+// a name interned into the symbol table
+x3::rule<class symbol, symbols::Symbol> const symbol = "symbol";
+auto const symbol_def = name;
+
 x3::rule<class type_, ast::Type_> const type_ = "type_";
-auto const type__def = name >> *(lit("::") >> name);
+auto const type__def = symbol >> *(lit("::") >> symbol);
 
 x3::rule<class type_qualifiers, std::vector<ast::TypeQualifier>> const
     type_qualifiers = "type_qualifiers";
@@ -217,7 +228,10 @@ x3::rule<class type, ast::Type> const type = "type";
 x3::rule<class template_values, ast::TemplateTypes> const template_values =
     "template_values";
 
-auto const var_type_def = (type_) >> -(optionaly_space >> template_values);
+// a '<' may start template values or be a comparison, the memoized results
+// keep a chain of comparisons from scanning to its end at every '<'
+auto const var_type_def =
+    (type_) >> -(optionaly_space >> memo::memoize(template_values));
 
 auto const template_values_def = '<' >> optionaly_space >>
                                  ((type | digits) % arg_separator) >> '>';
@@ -240,9 +254,12 @@ x3::rule<class arg_init_list> const arg_init_list = "arg_init_list";
 
 // TODO: type here denotes a variable name
 // change it to variable_type that also covers ::var
-auto const argument_def = arg_init_list | function_call | var_type |
-                          x3::omit[number] | x3::omit[char_literal] |
-                          x3::omit[string_literal] | paren_expression_old;
+// the alternatives are memoized, a failed one is retried at the same position
+// whenever an enclosing expression backtracks
+auto const argument_def =
+    memo::memoize(arg_init_list) | memo::memoize(function_call) | var_type |
+    x3::omit[number] | x3::omit[char_literal] | x3::omit[string_literal] |
+    memo::memoize(paren_expression_old);
 
 auto const optionaly_arguments_def =
     -((expression_old | init_list) % arg_separator);
@@ -504,11 +521,11 @@ x3::rule<class enumerators, std::vector<std::string>> const enumerators =
     "enumerators";
 auto const enumerators_def = name % arg_separator;
 
-BOOST_SPIRIT_DEFINE(
+GRAMMAR_PROFILE_DEFINE(
     some_space, optionaly_space, include, skip_line, comment, arg_separator,
     class_access_modifier, prefix_operator, sufix_operator,
     all_overloadable_operators, operator_sep_old, operator_sep, call_operator,
-    scope_begin, scope_end, namespace_begin, statement_end, name, type_,
+    scope_begin, scope_end, namespace_begin, statement_end, name, symbol, type_,
     type_qualifiers, type, var_type, template_values, digits, integral,
     floating, number, quoted_string, string_literal, char_literal, argument,
     optionaly_arguments, function_call, expression_old, paren_expression_old,
@@ -519,12 +536,12 @@ BOOST_SPIRIT_DEFINE(
     param, optional_param, param_optionaly_default, var_old, var_with_init,
     constructor_init, for_loop, while_loop, if_expression, else_expression);
 
-BOOST_SPIRIT_DEFINE(template_parameter, template_parameters, is_noexcept,
-                    function_signiture, function_start, is_pure_virtual,
-                    method_signiture, operator_signiture, constructor,
-                    class_inheritance, class_inheritances, class_or_struct,
-                    enumeration, enumerators, variable_expression,
-                    fce_expression);
+GRAMMAR_PROFILE_DEFINE(template_parameter, template_parameters, is_noexcept,
+                       function_signiture, function_start, is_pure_virtual,
+                       method_signiture, operator_signiture, constructor,
+                       class_inheritance, class_inheritances,
+                       class_or_struct, enumeration, enumerators,
+                       variable_expression, fce_expression, opens_scope);
 }  // namespace std_parser::rules
 
 #endif  //! STD_RULES_H
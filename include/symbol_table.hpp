@@ -0,0 +1,148 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace symbols {
+
+/**
+ * The interned strings of the whole process, every distinct string is stored
+ * once and never freed so a Symbol can point to it
+ *
+ * Split into independently locked shards like concurrent::ShardedSet so
+ * threads parsing different files rarely contend
+ */
+class SymbolTable {
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    // a deque doesn't move its elements when it grows, the views stay valid
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, std::string const*> index;
+  };
+
+  /**
+   * The strings a thread interned last, found without taking a lock
+   */
+  struct Seen {
+    // the id of the table they are from, ids aren't reused like addresses
+    std::uint64_t table = 0;
+    std::unordered_map<std::string_view, std::string const*> strings;
+  };
+
+  // most names repeat within a file, more than that is cleared
+  static constexpr std::size_t max_seen = 1 << 14;
+
+  std::vector<Shard> shards;
+  std::string const empty;
+  std::uint64_t id;
+
+  static std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> tables{1};
+    return tables++;
+  }
+
+ public:
+  explicit SymbolTable(std::size_t number_of_shards = 64)
+      : shards(number_of_shards), id{next_id()} {}
+
+  SymbolTable(SymbolTable const&) = delete;
+  SymbolTable& operator=(SymbolTable const&) = delete;
+
+  /**
+   * Return the stored copy of the string, the same address for equal strings
+   */
+  std::string const* intern(std::string_view str) {
+    if (str.empty()) {
+      return &empty;
+    }
+
+    thread_local Seen seen;
+    if (seen.table != id || seen.strings.size() >= max_seen) {
+      seen.strings.clear();
+      seen.table = id;
+    }
+    if (auto it = seen.strings.find(str); it != seen.strings.end()) {
+      return it->second;
+    }
+
+    auto hash = std::hash<std::string_view>{}(str);
+    auto& shard = shards[hash % shards.size()];
+    std::lock_guard lock{shard.mutex};
+    auto it = shard.index.find(str);
+    if (it == shard.index.end()) {
+      auto& stored = shard.strings.emplace_back(str);
+      it = shard.index.emplace(stored, &stored).first;
+    }
+
+    seen.strings.emplace(it->first, it->second);
+    return it->second;
+  }
+
+  std::size_t size() {
+    std::size_t size = 0;
+    for (auto& shard : shards) {
+      std::lock_guard lock{shard.mutex};
+      size += shard.strings.size();
+    }
+
+    return size;
+  }
+};
+
+inline SymbolTable& symbol_table() {
+  static SymbolTable table;
+  return table;
+}
+
+/**
+ * An interned identifier, a handle to its string in the symbol table
+ *
+ * It is copied, compared and hashed as a pointer, reading the string doesn't
+ * need the table
+ */
+class Symbol {
+  std::string const* value;
+
+ public:
+  Symbol() : value{symbol_table().intern({})} {}
+
+  Symbol(std::string_view str) : value{symbol_table().intern(str)} {}
+  Symbol(std::string const& str) : Symbol{std::string_view{str}} {}
+  Symbol(const char* str) : Symbol{std::string_view{str}} {}
+
+  std::string const& str() const { return *value; }
+
+  operator std::string_view() const { return *value; }
+
+  bool empty() const { return value->empty(); }
+
+  std::size_t hash() const { return std::hash<const void*>{}(value); }
+
+  friend bool operator==(Symbol a, Symbol b) { return a.value == b.value; }
+  friend bool operator!=(Symbol a, Symbol b) { return a.value != b.value; }
+
+  friend std::ostream& operator<<(std::ostream& out, Symbol s) {
+    return out << *s.value;
+  }
+};
+
+}  // namespace symbols
+
+namespace std {
+template <>
+struct hash<symbols::Symbol> {
+  std::size_t operator()(symbols::Symbol s) const { return s.hash(); }
+};
+}  // namespace std
+
+#endif  //! SYMBOL_TABLE_H
@@ -0,0 +1,307 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+/**
+ * Opt-in timeline of what the preprocessor spends its time on, in the Chrome
+ * trace event format (chrome://tracing, ui.perfetto.dev)
+ *
+ * Enabled by setting ZERO_PREPROCESSOR_TRACE to the path of the trace file.
+ * The events are appended to it when the process exits, so all the processes
+ * of a build, e.g. every main launched by CMake, end up in the same trace.
+ * The timestamps are of the steady clock, shared by the processes
+ *
+ * NOTE: the file is a JSON array that is never closed with ']', which the
+ * format allows so more processes can be appended to it
+ */
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * Append the JSON string literal of text to out
+ */
+inline void append_json_string(std::string& out, std::string_view text) {
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out += escaped;
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+/**
+ * The events of this process, written to the trace file on flush
+ */
+class Trace {
+  // the events are flushed when they get bigger than this
+  static constexpr std::size_t flush_size = 1 << 20;
+
+  std::filesystem::path path;
+  std::mutex mutex;
+  std::string events;
+  std::uint64_t process_id;
+
+  static std::uint64_t get_process_id() {
+#ifndef _WIN32
+    return ::getpid();
+#else
+    return ::_getpid();
+#endif
+  }
+
+  /**
+   * A small id of the calling thread, the first thread to trace is 1
+   */
+  static std::uint32_t thread_id() {
+    static std::atomic<std::uint32_t> threads{1};
+    thread_local std::uint32_t id = threads++;
+    return id;
+  }
+
+  static long long microseconds(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               time.time_since_epoch())
+        .count();
+  }
+
+  /**
+   * Append the fields every event has, the caller closes it
+   */
+  void begin_event(std::string_view category, std::string_view name,
+                   char phase, Clock::time_point time) {
+    events += "{\"name\":";
+    append_json_string(events, name);
+    events += ",\"cat\":";
+    append_json_string(events, category);
+    events += ",\"ph\":\"";
+    events += phase;
+    events += "\",\"ts\":";
+    events += std::to_string(microseconds(time));
+    events += ",\"pid\":";
+    events += std::to_string(process_id);
+    events += ",\"tid\":";
+    events += std::to_string(thread_id());
+  }
+
+  void end_event(std::string_view detail) {
+    if (!detail.empty()) {
+      events += ",\"args\":{\"detail\":";
+      append_json_string(events, detail);
+      events += '}';
+    }
+    events += "},\n";
+    if (events.size() > flush_size) {
+      write_events();
+    }
+  }
+
+  /**
+   * Append the events to the trace file, the first process to write it starts
+   * the array, must hold the mutex
+   */
+  void write_events() {
+    if (events.empty() || !enabled()) {
+      events.clear();
+      return;
+    }
+
+#ifndef _WIN32
+    int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                      0666);
+    // NOTE: the lock keeps the other processes from writing between the
+    // check of the size and the start of the array
+    bool ok = file != -1 && ::flock(file, LOCK_EX) == 0;
+    struct stat status;
+    if (ok && ::fstat(file, &status) == 0 && status.st_size == 0) {
+      events.insert(0, "[\n");
+    }
+    for (std::size_t written = 0; ok && written < events.size();) {
+      auto n = ::write(file, events.data() + written, events.size() - written);
+      ok = n > 0;
+      written += ok ? n : 0;
+    }
+    if (file != -1) {
+      ::close(file);
+    }
+#else
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) == 0 || ec) {
+      events.insert(0, "[\n");
+    }
+    auto file = std::fopen(path.string().c_str(), "ab");
+    bool ok = file != nullptr &&
+              std::fwrite(events.data(), 1, events.size(), file) ==
+                  events.size();
+    if (file != nullptr) {
+      ok = std::fclose(file) == 0 && ok;
+    }
+#endif
+    if (!ok) {
+      std::cerr << "can't write the trace " << path << std::endl;
+    }
+    events.clear();
+  }
+
+ public:
+  /**
+   * A trace written to path, nothing is traced if it is empty
+   */
+  explicit Trace(std::filesystem::path path)
+      : path{std::move(path)}, process_id{get_process_id()} {}
+
+  Trace(Trace const&) = delete;
+  Trace& operator=(Trace const&) = delete;
+
+  ~Trace() { flush(); }
+
+  /**
+   * The trace of the process, at ZERO_PREPROCESSOR_TRACE
+   */
+  static Trace& global() {
+    static Trace trace{[] {
+      auto path = std::getenv("ZERO_PREPROCESSOR_TRACE");
+      return std::filesystem::path{path != nullptr ? path : ""};
+    }()};
+    return trace;
+  }
+
+  bool enabled() const { return !path.empty(); }
+
+  /**
+   * Record something that took from start to end on the calling thread
+   */
+  void complete(std::string_view category, std::string_view name,
+                Clock::time_point start, Clock::time_point end,
+                std::string_view detail = {}) {
+    std::lock_guard lock{mutex};
+    begin_event(category, name, 'X', start);
+    events += ",\"dur\":";
+    events += std::to_string(microseconds(end) - microseconds(start));
+    end_event(detail);
+  }
+
+  /**
+   * Record something that took from start to end but not on one thread, e.g.
+   * a request waiting for a reply, the id tells apart overlapping ones
+   */
+  void async(std::string_view category, std::string_view name,
+             std::uint64_t id, Clock::time_point start, Clock::time_point end,
+             std::string_view detail = {}) {
+    std::lock_guard lock{mutex};
+    for (auto [phase, time] : {std::pair{'b', start}, std::pair{'e', end}}) {
+      begin_event(category, name, phase, time);
+      // NOTE: the ids of the other processes are told apart by the pid
+      events += ",\"id\":\"";
+      events += std::to_string(process_id) + '.' + std::to_string(id);
+      events += '"';
+      end_event(phase == 'b' ? detail : std::string_view{});
+    }
+  }
+
+  /**
+   * Name the process in the trace
+   */
+  void set_process_name(std::string_view name) {
+    std::lock_guard lock{mutex};
+    begin_event("__metadata", "process_name", 'M', Clock::time_point{});
+    events += ",\"args\":{\"name\":";
+    append_json_string(events, name);
+    events += "}},\n";
+  }
+
+  void flush() {
+    std::lock_guard lock{mutex};
+    write_events();
+  }
+};
+
+inline bool enabled() { return Trace::global().enabled(); }
+
+/**
+ * Records the time from its construction to its destruction on the global
+ * trace, the category and name have to outlive it
+ */
+class Span {
+  std::string_view category;
+  std::string_view name;
+  std::string detail;
+  Clock::time_point start;
+  bool on;
+
+ public:
+  Span(std::string_view category, std::string_view name,
+       std::string_view detail = {})
+      : category{category}, name{name}, on{enabled()} {
+    if (on) {
+      this->detail = detail;
+      start = Clock::now();
+    }
+  }
+
+  /**
+   * A span about the file at path, the path is only converted if tracing
+   */
+  template <class Path, std::enable_if_t<
+                            std::is_same_v<Path, std::filesystem::path>, int> = 0>
+  Span(std::string_view category, std::string_view name, Path const& path)
+      : Span{category, name} {
+    if (on) {
+      detail = path.string();
+    }
+  }
+
+  Span(Span const&) = delete;
+  Span& operator=(Span const&) = delete;
+
+  ~Span() {
+    if (on) {
+      Trace::global().complete(category, name, start, Clock::now(), detail);
+    }
+  }
+};
+
+}  // namespace trace
+
+#endif  //! TRACE_H
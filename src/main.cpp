@@ -1,13 +1,78 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
 
+#include <dependency_cache.hpp>
+#include <inputs_hash.hpp>
 #include <meta_classes.hpp>
+#include <meta_process_pool.hpp>
+#include <output_sink.hpp>
 #include <preprocessor.hpp>
 #include <source_loader.hpp>
 #include <static_reflection.hpp>
 #include <std_parser.hpp>
+#include <trace.hpp>
 
-int stage_one(int argc, char* argv[]) {
+/**
+ * Number of worker threads to use, read from ZERO_PREPROCESSOR_JOBS
+ *
+ * 0 means one per hardware thread, defaults to 1
+ */
+std::size_t get_number_of_jobs() {
+  auto jobs_env = std::getenv("ZERO_PREPROCESSOR_JOBS");
+  if (jobs_env == nullptr) {
+    return 1;
+  }
+
+  std::size_t jobs = std::strtoul(jobs_env, nullptr, 10);
+  if (jobs == 0) {
+    jobs = std::thread::hardware_concurrency();
+  }
+
+  return std::max<std::size_t>(jobs, 1);
+}
+
+/**
+ * The layout of the generated reflection, read from
+ * ZERO_PREPROCESSOR_REFLECTION
+ *
+ * "flat" for the flat layout, defaults to the tuple layout
+ */
+static_reflection::Layout get_reflection_layout() {
+  auto layout_env = std::getenv("ZERO_PREPROCESSOR_REFLECTION");
+  if (layout_env != nullptr && std::string_view{layout_env} == "flat") {
+    return static_reflection::Layout::Flat;
+  }
+
+  return static_reflection::Layout::Tuple;
+}
+
+/**
+ * Load the dependency cache at path, validating it if
+ * ZERO_PREPROCESSOR_VALIDATE_CACHE is set
+ */
+auto load_dependency_cache(fs::path const& path) {
+  auto cache = source::DependencyCache::load(path);
+  cache.set_validate(std::getenv("ZERO_PREPROCESSOR_VALIDATE_CACHE") !=
+                     nullptr);
+  return cache;
+}
+
+/**
+ * Write the dependencies of the source, uses the shared cache if given or
+ * else the cache beside the out file
+ */
+int stage_one(int argc, char* argv[],
+              source::DependencyCache* shared_cache = nullptr) {
   source::check_out_dir({argv[3]});
 
   std::vector<std::string> inc_dirs;
@@ -25,24 +90,42 @@ int stage_one(int argc, char* argv[]) {
   };
   Preprocessor preprocessor(std::move(loader), std_parser);
 
-  std::ofstream out_file(argv[3], std::ios::out);
+  source::OutputSink out_file{argv[3]};
   auto writer = [&out_file](auto& src) {
-    for (auto& elem : src) {
-      out_file << elem;
+    out_file.write(src);
+    out_file.put('\n');
+  };
+  auto commit = [&] {
+    if (!out_file.commit()) {
+      std::cerr << "can't write " << argv[3] << std::endl;
+      return 1;
     }
-    out_file << '\n';
+    return 0;
   };
-  preprocessor.get_dependencies(argv[2], writer);
 
-  return 0;
+  if (shared_cache != nullptr) {
+    preprocessor.get_dependencies(argv[2], writer, get_number_of_jobs(),
+                                  *shared_cache);
+    return commit();
+  }
+
+  // the direct includes of the crawled files are cached beside the out file
+  fs::path cache_path = argv[3];
+  cache_path += ".cache";
+  auto cache = load_dependency_cache(cache_path);
+  preprocessor.get_dependencies(argv[2], writer, get_number_of_jobs(), cache);
+  cache.save(cache_path);
+
+  return commit();
 }
 
 auto read_sources(std::string_view file) {
   std::cout << "reading sources to process \n";
   std::vector<std::pair<std::string, std::string>> sources;
   std::ifstream in_file(file.data());
+  // a path on every line, it may hold spaces
   std::string first, second;
-  while (in_file >> first >> second) {
+  while (std::getline(in_file, first) && std::getline(in_file, second)) {
     std::cout << "read: " << first << " , " << second << std::endl;
     sources.emplace_back(std::move(first), std::move(second));
   }
@@ -77,58 +160,124 @@ int stage_two(int argc, char* argv[]) {
   return 0;
 }
 
-int stage_three(int argc, char* argv[]) {
-  if (argc != 6) {
-    return 1;
-  }
-
-  auto sources = read_sources(argv[4]);
-  sources.emplace_back(argv[2], argv[3]);
+using source::SourcePairs;
 
+/**
+ * Process the (in, out) pairs until there are none left
+ *
+ * Every caller gets its own Preprocessor and parsers so this can run on
+ * multiple threads sharing the next counter and the meta processes
+ */
+void process_sources(SourcePairs const& sources, std::atomic<std::size_t>& next,
+                     meta_classes::MetaProcessPool& meta_processes) {
   source::SourceLoader loader{{}, "include"};
 
   auto meta_classes = [&](auto& parent) {
-    return meta_classes::MetaClassParser{parent, argv[5], ""};
+    return meta_classes::MetaClassParser{parent, meta_processes, ""};
   };
 
-  auto static_ref = [](auto& parent) {
-    return static_reflection::StaticReflexParser{parent};
+  auto static_ref = [layout = get_reflection_layout()](auto& parent) {
+    return static_reflection::StaticReflexParser{parent, layout};
   };
 
   auto std_parser = [](auto&) { return std_parser::StdParser{}; };
   Preprocessor preprocessor(std::move(loader), meta_classes, static_ref,
                             std_parser);
 
+  for (auto i = next++; i < sources.size(); i = next++) {
+    auto& [in, out] = sources[i];
+    std::cout << "processing " + in + " into " + out + '\n' << std::flush;
+    std::string processed;
+    auto writer = [&processed](auto& src) {
+      processed.append(std::begin(src), std::end(src));
+    };
+    preprocessor.process_source(in, writer);
+    source::write_if_changed(out, processed);
+  }
+}
+
+int stage_three(int argc, char* argv[]) {
+  if (argc != 6) {
+    return 1;
+  }
+
+  auto sources = read_sources(argv[4]);
+  sources.emplace_back(argv[2], argv[3]);
+
+  // skip everything if nothing changed since the last successful run
+  fs::path stamp_path = argv[4];
+  stamp_path += ".stamp";
+  auto layout = std::to_string(static_cast<int>(get_reflection_layout()));
+  auto inputs_hash = source::get_inputs_hash(
+      sources, argv[5], source::get_self_path(argv[0]), layout);
+  if (source::is_up_to_date(sources, stamp_path, inputs_hash)) {
+    // NOTE: rewrite the stamp for the build tools that check its time
+    std::ofstream(stamp_path) << inputs_hash;
+    std::cout << "up to date" << std::endl;
+    return 0;
+  }
+
+  // NOTE: create the out dirs up front so the workers don't race on them
   for (auto& pair : sources) {
-    std::cout << "processing " << pair.first << " into " << pair.second
-              << std::endl;
     source::check_out_dir(pair.second);
-    std::ofstream out_file(pair.second, std::ios::out);
-    // TODO: need to provide a writer for the processed content
-    auto writer = [&out_file](auto& src) {
-      for (auto& elem : src) {
-        out_file << elem;
+  }
+
+  // NOTE: a file can have many meta classes, so the meta processes aren't
+  // limited by the number of sources
+  meta_classes::MetaProcessPool meta_processes{argv[5], get_number_of_jobs()};
+
+  std::atomic<std::size_t> next = 0;
+  auto jobs = std::min(get_number_of_jobs(), sources.size());
+  if (jobs <= 1) {
+    process_sources(sources, next, meta_processes);
+  } else {
+    std::cout << "processing with " << jobs << " threads" << std::endl;
+    std::vector<std::exception_ptr> errors(jobs);
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+    for (std::size_t i = 0; i < jobs; ++i) {
+      workers.emplace_back([&, i] {
+        try {
+          process_sources(sources, next, meta_processes);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    for (auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
       }
-    };
-    preprocessor.process_source(pair.first, writer);
+    }
   }
 
+  meta_processes.report_utilization(std::cout);
+  std::ofstream(stamp_path) << inputs_hash;
+
   std::cout << "DONE" << std::endl;
   return 0;
 }
 
-int main(int argc, char* argv[]) {
-  std::cout << "start\n";
-  if (argc == 1) {
-    return 1;
-  }
-
+/**
+ * Run the stage given by argv[1] with the rest of the arguments
+ */
+int run_stage(int argc, char* argv[],
+              source::DependencyCache* shared_cache = nullptr) {
   int stage = std::atoi(argv[1]);
   std::cout << "stage" << stage << "\n";
 
+  constexpr std::string_view names[] = {"stage 1", "stage 2", "stage 3"};
+  trace::Span traced{"stage", stage >= 1 && stage <= 3 ? names[stage - 1] : "",
+                   argc > 2 ? argv[2] : ""};
+
   switch (stage) {
     case 1:
-      return stage_one(argc, argv);
+      return stage_one(argc, argv, shared_cache);
       break;
     case 2:
       return stage_two(argc, argv);
@@ -142,3 +291,109 @@ int main(int argc, char* argv[]) {
 
   return 0;
 }
+
+/**
+ * Run every line of the manifest as the arguments of one of the other stages,
+ * all in this process. The arguments are separated by tabs so they can hold
+ * spaces e.g.
+ *   1\tsrc/main.cpp\tout/includes1.txt\tinclude dir
+ *   2\tsrc/main.cpp\tout/includes1.txt\tmeta_out
+ *
+ * All the include crawls share the dependency cache beside the manifest so
+ * the headers common to the sources are parsed only once
+ */
+int stage_batch(int argc, char* argv[]) {
+  if (argc != 3) {
+    return 1;
+  }
+
+  std::ifstream manifest(argv[2]);
+  if (!manifest.is_open()) {
+    std::cerr << argv[2] << " manifest can't be opened" << std::endl;
+    return 1;
+  }
+
+  trace::Span traced{"stage", "stage 4", argv[2]};
+  fs::path cache_path = argv[2];
+  cache_path += ".cache";
+  auto cache = load_dependency_cache(cache_path);
+  bool crawled = false;
+
+  std::string line;
+  while (std::getline(manifest, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    std::istringstream words(line);
+    std::vector<std::string> args = {argv[0]};
+    for (std::string word; std::getline(words, word, '\t');) {
+      if (!word.empty()) {
+        args.push_back(std::move(word));
+      }
+    }
+
+    if (args.size() == 1) {
+      continue;
+    }
+
+    int stage = std::atoi(args[1].c_str());
+    if (stage == 4) {
+      std::cerr << "batches can't be nested" << std::endl;
+      return 1;
+    }
+    crawled |= stage == 1;
+
+    std::vector<char*> stage_argv;
+    for (auto& arg : args) {
+      stage_argv.push_back(arg.data());
+    }
+    int stage_argc = stage_argv.size();
+    stage_argv.push_back(nullptr);
+
+    if (int result = run_stage(stage_argc, stage_argv.data(), &cache);
+        result != 0) {
+      return result;
+    }
+  }
+
+  if (crawled) {
+    cache.save(cache_path);
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  std::cout << "start\n";
+  if (argc == 1) {
+    return 1;
+  }
+
+#ifdef SIGPIPE
+  // a request can be sent to a meta process that just exited, it is sent
+  // again after the restart so the failed write is ignored
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  // the processes of a build are told apart by their arguments in the trace
+  if (trace::enabled()) {
+    std::string name = "main";
+    for (int i = 1; i < argc; ++i) {
+      name += ' ';
+      name += argv[i];
+    }
+    trace::Trace::global().set_process_name(name);
+  }
+
+  try {
+    if (std::atoi(argv[1]) == 4) {
+      std::cout << "batch\n";
+      return stage_batch(argc, argv);
+    }
+
+    return run_stage(argc, argv);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
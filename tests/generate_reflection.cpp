@@ -0,0 +1,52 @@
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <output_sink.hpp>
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+#include <static_reflection.hpp>
+#include <std_parser.hpp>
+
+/**
+ * Write the source with the static reflection of its types in the layout, the
+ * tests of reflect.hpp compile the reflection of both layouts
+ */
+int main(int argc, char* argv[]) {
+  std::string_view layout_name = argc == 4 ? argv[1] : "";
+  if (layout_name != "tuple" && layout_name != "flat") {
+    std::cerr << "usage: " << argv[0] << " tuple|flat in out" << std::endl;
+    return 2;
+  }
+
+  auto layout = layout_name == "flat" ? static_reflection::Layout::Flat
+                                      : static_reflection::Layout::Tuple;
+  auto std_parser = [](auto&) { return std_parser::StdParser{}; };
+  auto static_ref = [layout](auto& parent) {
+    return static_reflection::StaticReflexParser{parent, layout};
+  };
+  Preprocessor preprocessor(source::SourceLoader{{}, ""}, static_ref,
+                            std_parser);
+  std::string processed;
+  auto writer = [&processed](auto& src) {
+    processed.append(std::begin(src), std::end(src));
+  };
+  try {
+    preprocessor.process_source(argv[2], writer);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::filesystem::create_directories(
+      std::filesystem::path{argv[3]}.parent_path());
+  source::OutputSink out{argv[3]};
+  out << processed;
+  if (!out.commit()) {
+    std::cerr << "can't write " << argv[3] << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,28 @@
+#include <string>
+
+#include <char_scan.hpp>
+
+#include "catch.hpp"
+
+TEST_CASE("Find either of two characters", "[char_scan]") {
+  // cover the vectorized and the scalar parts of the search
+  for (std::size_t size : {0, 1, 15, 16, 17, 31, 32, 33, 64, 100}) {
+    std::string text(size, 'x');
+    auto first = text.data();
+    auto last = first + text.size();
+
+    REQUIRE(char_scan::find_eol(first, last) == last);
+    REQUIRE(char_scan::find(first, last, '#') == last);
+
+    for (std::size_t i = 0; i < size; ++i) {
+      text[i] = i % 2 ? '\n' : '\r';
+      REQUIRE(char_scan::find_eol(first, last) == first + i);
+
+      text[i] = '#';
+      REQUIRE(char_scan::find(first, last, '#') == first + i);
+      REQUIRE(char_scan::find_eol(first, last) == last);
+
+      text[i] = 'x';
+    }
+  }
+}
@@ -0,0 +1,203 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dependency_cache.hpp>
+#include <preprocessor.hpp>
+#include <source_loader.hpp>
+#include <std_parser.hpp>
+
+#include "catch.hpp"
+
+TEST_CASE("Dependency cache round trip", "[dependency_cache]") {
+  auto path = fs::temp_directory_path() / "zero_preprocessor_test.cache";
+  fs::remove(path);
+
+  REQUIRE(source::DependencyCache::load(path).size() == 0);
+
+  source::DependencyCache cache;
+  cache.update({{"a.hpp", {1, 2}, 3, {"b.hpp", "c.hpp"}}, {"b.hpp", {4, 5}, 6, {}}});
+  cache.save(path);
+
+  auto loaded = source::DependencyCache::load(path);
+  REQUIRE(loaded.size() == 2);
+
+  auto a = loaded.find("a.hpp");
+  REQUIRE(a != nullptr);
+  REQUIRE(a->stamp == source::FileStamp{1, 2});
+  REQUIRE(a->hash == 3);
+  REQUIRE(a->includes == std::vector<std::string>{"b.hpp", "c.hpp"});
+
+  auto b = loaded.find("b.hpp");
+  REQUIRE(b != nullptr);
+  REQUIRE(b->includes.empty());
+  REQUIRE(loaded.find("c.hpp") == nullptr);
+
+  // only the entries updated after loading are saved again
+  loaded.update({{"b.hpp", {7, 8}, 9, {"d.hpp"}}});
+  loaded.save(path);
+  auto pruned = source::DependencyCache::load(path);
+  REQUIRE(pruned.size() == 1);
+  REQUIRE(pruned.find("a.hpp") == nullptr);
+  REQUIRE(pruned.find("b.hpp")->includes == std::vector<std::string>{"d.hpp"});
+
+  // a truncated cache is ignored
+  fs::resize_file(path, fs::file_size(path) - 1);
+  REQUIRE(source::DependencyCache::load(path).size() == 0);
+
+  {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out << "not a cache";
+  }
+  REQUIRE(source::DependencyCache::load(path).size() == 0);
+
+  fs::remove(path);
+}
+
+TEST_CASE("Dependency cache with corrupt counts", "[dependency_cache]") {
+  auto path = fs::temp_directory_path() / "zero_preprocessor_corrupt.cache";
+  source::DependencyCache cache;
+  cache.update({{"a.hpp", {1, 2}, 3, {"b.hpp"}}});
+  REQUIRE(cache.save(path));
+
+  // the length of the path of the first entry, after magic, version and count
+  auto corrupt = [&path](std::streamoff offset) {
+    std::fstream out(path, std::ios::in | std::ios::out | std::ios::binary);
+    out.seekp(offset);
+    std::uint32_t huge = 0xffffffff;
+    out.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+  };
+  corrupt(12);
+  REQUIRE(source::DependencyCache::load(path).size() == 0);
+
+  // the number of includes, after the path "a.hpp", mtime, size and hash
+  REQUIRE(cache.save(path));
+  corrupt(12 + 4 + 5 + 8 + 8 + 8);
+  REQUIRE(source::DependencyCache::load(path).size() == 0);
+
+  fs::remove(path);
+}
+
+TEST_CASE("Dependency cache saved by many writers", "[dependency_cache]") {
+  auto dir = fs::temp_directory_path() / "zero_preprocessor_cache_writers";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  auto path = dir / "same.cache";
+
+  source::DependencyCache cache;
+  cache.update({{"a.hpp", {1, 2}, 3, {"b.hpp"}}});
+  // like the processes of a batch saving the cache of the same manifest
+  std::atomic<int> saved{0};
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 8; ++i) {
+    writers.emplace_back([&] {
+      for (int j = 0; j < 16; ++j) {
+        saved += cache.save(path);
+      }
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  REQUIRE(saved == 8 * 16);
+  REQUIRE(source::DependencyCache::load(path).find("a.hpp") != nullptr);
+  // no temporary file is left behind
+  REQUIRE(std::distance(fs::directory_iterator{dir}, {}) == 1);
+
+  // a cache that can't be written doesn't throw
+  REQUIRE_FALSE(cache.save(dir / "missing" / "dir.cache"));
+  REQUIRE(std::distance(fs::directory_iterator{dir}, {}) == 1);
+
+  fs::remove_all(dir);
+}
+
+/**
+ * A std parser that counts the sources it scans for includes
+ */
+struct CountingParser : std_parser::StdParser {
+  static inline std::atomic<int> scans{0};
+
+  template <class Source>
+  auto get_includes(Source& source) {
+    ++scans;
+    return std_parser::StdParser::get_includes(source);
+  }
+};
+
+TEST_CASE("Crawl the includes through the dependency cache",
+          "[dependency_cache]") {
+  auto dir = fs::temp_directory_path() / "zero_preprocessor_crawl";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  auto write = [&dir](std::string const& name, std::string const& content) {
+    std::ofstream(dir / name, std::ios::binary) << content;
+  };
+  write("main.cpp", "#include \"a.hpp\"\nint main() {}\n");
+  write("a.hpp", "#include \"b.hpp\"\nint a;\n");
+  write("b.hpp", "int b;\n");
+  write("c.hpp", "int c;\n");
+  auto main_path = (dir / "main.cpp").string();
+
+  source::DependencyCache cache;
+  // the number of sources scanned and the dependencies written
+  auto crawl = [&] {
+    Preprocessor preprocessor{
+        source::SourceLoader{{dir.string()}, "include"},
+        [](auto&) { return CountingParser{}; }};
+    std::vector<std::string> written;
+    auto writer = [&written](auto const& path) { written.push_back(path); };
+    CountingParser::scans = 0;
+    preprocessor.get_dependencies(main_path, writer, 1, cache);
+    return std::pair{CountingParser::scans.load(), written.size()};
+  };
+
+  REQUIRE(crawl() == std::pair{3, std::size_t{4}});
+
+  // nothing changed
+  REQUIRE(crawl() == std::pair{0, std::size_t{4}});
+
+  // a new modification time with the same content
+  auto a_path = dir / "a.hpp";
+  auto a_time = fs::last_write_time(a_path);
+  write("a.hpp", "#include \"b.hpp\"\nint a;\n");
+  fs::last_write_time(a_path, a_time + std::chrono::hours{1});
+  REQUIRE(crawl() == std::pair{0, std::size_t{4}});
+
+  // new content of the same size, only a.hpp is scanned again
+  a_time = fs::last_write_time(a_path);
+  write("a.hpp", "#include \"c.hpp\"\nint a;\n");
+  fs::last_write_time(a_path, a_time + std::chrono::hours{1});
+  auto [scans, written] = crawl();
+  REQUIRE(scans == 2);
+  REQUIRE(written == 4);
+  REQUIRE(cache.find(a_path.string())->includes ==
+          std::vector<std::string>{"c.hpp"});
+
+  // the content changes behind an unchanged stamp, only validation sees it
+  a_time = fs::last_write_time(a_path);
+  write("a.hpp", "#include \"b.hpp\"\nint a;\n");
+  fs::last_write_time(a_path, a_time);
+  REQUIRE(crawl() == std::pair{0, std::size_t{4}});
+  REQUIRE(cache.find(a_path.string())->includes ==
+          std::vector<std::string>{"c.hpp"});
+
+  cache.set_validate(true);
+  std::ostringstream errors;
+  auto old_errors = std::cerr.rdbuf(errors.rdbuf());
+  auto validated = crawl();
+  std::cerr.rdbuf(old_errors);
+  REQUIRE(validated.first == 3);
+  REQUIRE(errors.str() ==
+          "stale dependency cache entry for " + a_path.string() + '\n');
+  REQUIRE(cache.find(a_path.string())->includes ==
+          std::vector<std::string>{"b.hpp"});
+
+  fs::remove_all(dir);
+}
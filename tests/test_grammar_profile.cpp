@@ -0,0 +1,46 @@
+#include <sstream>
+#include <string>
+
+#include <grammar_profile.hpp>
+
+#include "catch.hpp"
+
+TEST_CASE("rules count their backtracked bytes", "[grammar_profile]") {
+  grammar_profile::Profile profile;
+  auto& outer = profile.rule("outer");
+  auto& inner = profile.rule("inner");
+  REQUIRE(&profile.rule("inner") == &inner);
+
+  std::string input = "struct S : public Base {";
+  auto first = input.cbegin();
+
+  // inner matches 6 bytes and then outer fails
+  REQUIRE(!grammar_profile::profile(outer, first, [&] {
+    auto it = first;
+    REQUIRE(grammar_profile::profile(inner, it, [&] {
+      it += 6;
+      return true;
+    }));
+    return false;
+  }));
+  REQUIRE(first == input.cbegin());
+
+  // outer matches everything with no inner rule
+  REQUIRE(grammar_profile::profile(outer, first, [&] {
+    first = input.cend();
+    return true;
+  }));
+
+  REQUIRE(outer.attempts == 2);
+  REQUIRE(outer.successes == 1);
+  REQUIRE(outer.failures() == 1);
+  REQUIRE(outer.bytes_consumed == input.size());
+  REQUIRE(outer.bytes_backtracked == 6);
+  REQUIRE(inner.bytes_consumed == 6);
+  REQUIRE(inner.bytes_backtracked == 0);
+
+  std::ostringstream report;
+  profile.report(report);
+  auto text = report.str();
+  REQUIRE(text.find("outer") < text.find("inner"));
+}
@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <inputs_hash.hpp>
+
+#include "catch.hpp"
+
+TEST_CASE("Hash the inputs of the last stage", "[inputs_hash]") {
+  auto dir = fs::temp_directory_path() / "zero_preprocessor_inputs";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "out");
+  auto write = [](fs::path const& path, std::string const& content) {
+    std::ofstream(path, std::ios::binary) << content;
+  };
+  auto in = [&dir](std::string const& name) { return (dir / name).string(); };
+  auto out = [&dir](std::string const& name) {
+    return (dir / "out" / name).string();
+  };
+
+  write(in("main.cpp"), "#include \"a.hpp\"\nint main() {}\n");
+  write(in("a.hpp"), "int a;\n");
+  write(in("meta"), "the meta executable");
+  write(in("self"), "the preprocessor");
+  source::SourcePairs sources{{in("a.hpp"), out("a.hpp")},
+                              {in("main.cpp"), out("main.cpp")}};
+  auto hash = [&](std::string const& options = "0") {
+    return source::get_inputs_hash(sources, in("meta"), in("self"), options);
+  };
+
+  auto inputs = hash();
+  REQUIRE(hash() == inputs);
+
+  // a listed include
+  write(in("a.hpp"), "int b;\n");
+  REQUIRE(hash() != inputs);
+  write(in("a.hpp"), "int a;\n");
+  REQUIRE(hash() == inputs);
+
+  // the meta executable
+  write(in("meta"), "a new meta executable");
+  REQUIRE(hash() != inputs);
+  write(in("meta"), "the meta executable");
+  REQUIRE(hash() == inputs);
+
+  // the reflection layout
+  REQUIRE(hash("1") != inputs);
+
+  // where a source is written
+  sources[0].second = out("b.hpp");
+  REQUIRE(hash() != inputs);
+  sources[0].second = out("a.hpp");
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Check the outputs against the inputs hash", "[inputs_hash]") {
+  auto dir = fs::temp_directory_path() / "zero_preprocessor_stamp";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  auto stamp = dir / "includes.txt.stamp";
+  auto output = (dir / "main.cpp").string();
+  source::SourcePairs sources{{"main.cpp", output}};
+  std::uint64_t inputs = 1234;
+
+  // no stamp yet
+  REQUIRE_FALSE(source::is_up_to_date(sources, stamp, inputs));
+
+  std::ofstream(output) << "int main() {}\n";
+  std::ofstream(stamp) << inputs;
+  REQUIRE(source::is_up_to_date(sources, stamp, inputs));
+  REQUIRE_FALSE(source::is_up_to_date(sources, stamp, inputs + 1));
+
+  // a missing output is generated again
+  fs::remove(output);
+  REQUIRE_FALSE(source::is_up_to_date(sources, stamp, inputs));
+
+  std::ofstream(output) << "int main() {}\n";
+  std::ofstream(stamp) << "not a hash";
+  REQUIRE_FALSE(source::is_up_to_date(sources, stamp, inputs));
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,114 @@
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <lexer.hpp>
+
+#include "catch.hpp"
+
+using lexer::TokenKind;
+
+namespace {
+/**
+ * The kinds and texts of the tokens of the text
+ */
+std::vector<std::pair<TokenKind, std::string>> lex_all(std::string_view text) {
+  std::vector<std::pair<TokenKind, std::string>> lexed;
+  std::size_t end = 0;
+  for (auto& token : lexer::tokenize(text)) {
+    REQUIRE(token.offset == end);
+    end = token.end();
+    lexed.emplace_back(token.kind,
+                       std::string{text.substr(token.offset, token.length)});
+  }
+  REQUIRE(end == text.size());
+  return lexed;
+}
+}  // namespace
+
+TEST_CASE("Split a source into tokens", "[lexer]") {
+  using Lexed = std::vector<std::pair<TokenKind, std::string>>;
+
+  REQUIRE(lex_all("").empty());
+  REQUIRE(lex_all("int a_1 = 0x1F;") ==
+          Lexed{{TokenKind::Identifier, "int"},
+                {TokenKind::Space, " "},
+                {TokenKind::Identifier, "a_1"},
+                {TokenKind::Space, " "},
+                {TokenKind::Punctuation, "="},
+                {TokenKind::Space, " "},
+                {TokenKind::Number, "0x1F"},
+                {TokenKind::Punctuation, ";"}});
+  REQUIRE(lex_all("1.5e-3f+.2") == Lexed{{TokenKind::Number, "1.5e-3f"},
+                                         {TokenKind::Punctuation, "+"},
+                                         {TokenKind::Number, ".2"}});
+  REQUIRE(lex_all("// a\r\n/* b\n c */\t") ==
+          Lexed{{TokenKind::LineComment, "// a"},
+                {TokenKind::Space, "\r\n"},
+                {TokenKind::BlockComment, "/* b\n c */"},
+                {TokenKind::Space, "\t"}});
+  REQUIRE(lex_all("\"a\\\"b\" 'c' u8\"d\" L'e'") ==
+          Lexed{{TokenKind::String, "\"a\\\"b\""},
+                {TokenKind::Space, " "},
+                {TokenKind::Char, "'c'"},
+                {TokenKind::Space, " "},
+                {TokenKind::String, "u8\"d\""},
+                {TokenKind::Space, " "},
+                {TokenKind::Char, "L'e'"}});
+  REQUIRE(lex_all("R\"x(a)\" b)x\" R") ==
+          Lexed{{TokenKind::String, "R\"x(a)\" b)x\""},
+                {TokenKind::Space, " "},
+                {TokenKind::Identifier, "R"}});
+}
+
+TEST_CASE("Lex unterminated comments and literals", "[lexer]") {
+  using Lexed = std::vector<std::pair<TokenKind, std::string>>;
+
+  REQUIRE(lex_all("/* a") == Lexed{{TokenKind::Punctuation, "/"},
+                                   {TokenKind::Punctuation, "*"},
+                                   {TokenKind::Space, " "},
+                                   {TokenKind::Identifier, "a"}});
+  REQUIRE(lex_all("\"a\nb\"") == Lexed{{TokenKind::Punctuation, "\""},
+                                       {TokenKind::Identifier, "a"},
+                                       {TokenKind::Space, "\n"},
+                                       {TokenKind::Identifier, "b"},
+                                       {TokenKind::Punctuation, "\""}});
+}
+
+TEST_CASE("Look up the tokens of a stream", "[lexer]") {
+  // long enough to be lexed in several windows
+  std::string text;
+  for (int i = 0; i < 1000; ++i) {
+    text += "int a" + std::to_string(i) + "; // comment\n  /* block */ ";
+  }
+  const char* begin = text.data();
+
+  lexer::TokenStream tokens;
+  tokens.tokenize(begin, begin + text.size());
+
+  std::size_t statements = 0;
+  const char* position = begin;
+  while (position != begin + text.size()) {
+    auto token = tokens.at(position);
+    REQUIRE(token != nullptr);
+    REQUIRE(tokens.get_text(*token) == "int");
+    // inside a token
+    REQUIRE(tokens.at(position + 1) == nullptr);
+
+    position = text.data() + text.find(';', position - begin) + 1;
+    auto blank_end = tokens.skip_blank(position);
+    REQUIRE(std::string_view(position, blank_end - position) ==
+            " // comment\n  /* block */ ");
+    position = blank_end;
+    ++statements;
+  }
+  REQUIRE(statements == 1000);
+
+  // not blank and out of the source
+  REQUIRE(tokens.skip_blank(begin + text.find(';')) == begin + text.find(';'));
+  REQUIRE(tokens.at(begin - 1) == nullptr);
+
+  tokens.clear();
+  REQUIRE(tokens.at(begin) == nullptr);
+}
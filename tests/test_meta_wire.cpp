@@ -0,0 +1,140 @@
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <meta_include/meta.hpp>
+#include <meta_include/meta_wire.hpp>
+
+#include "catch.hpp"
+
+using namespace meta;
+
+namespace {
+/**
+ * The payload of the frame, without its size
+ */
+std::string payload_of(wire::Writer& writer) {
+  return writer.data().substr(sizeof(std::uint32_t));
+}
+}  // namespace
+
+TEST_CASE("Read the values a frame was written with", "[meta_wire]") {
+  wire::Writer writer{wire::Message::Generate};
+  writer.pod(std::uint32_t{7})
+      .str("a class")
+      .boolean(true)
+      .pod(std::uint16_t{65535})
+      .str("")
+      .boolean(false)
+      .enumeration(wire::Message::Error);
+
+  auto& frame = writer.data();
+  std::uint32_t size;
+  std::memcpy(&size, frame.data(), sizeof(size));
+  REQUIRE(size == frame.size() - sizeof(size));
+
+  auto payload = payload_of(writer);
+  wire::Reader in{payload};
+  REQUIRE(in.message() == wire::Message::Generate);
+  REQUIRE(in.pod<std::uint32_t>() == 7);
+  REQUIRE(in.str() == "a class");
+  REQUIRE(in.boolean());
+  REQUIRE(in.pod<std::uint16_t>() == 65535);
+  REQUIRE(in.str().empty());
+  REQUIRE(!in.boolean());
+  REQUIRE(in.enumeration<wire::Message>() == wire::Message::Error);
+  REQUIRE_THROWS_AS(in.pod<std::uint8_t>(), std::runtime_error);
+}
+
+TEST_CASE("Throw on truncated frames", "[meta_wire]") {
+  wire::Writer writer{wire::Message::Generated};
+  writer.pod(std::uint32_t{1}).str("the generated class").boolean(true);
+  auto payload = payload_of(writer);
+
+  // cut before every byte of the payload
+  for (std::size_t size = 0; size < payload.size(); ++size) {
+    INFO(size);
+    wire::Reader in{std::string_view{payload}.substr(0, size)};
+    REQUIRE_THROWS_AS((in.message(), in.pod<std::uint32_t>(), in.str(),
+                       in.boolean()),
+                      std::runtime_error);
+  }
+
+  // a string longer than the frame
+  wire::Writer lying{wire::Message::Generated};
+  lying.pod(std::uint32_t{1}).pod(std::uint32_t{1000}).pod(char{'a'});
+  auto lie = payload_of(lying);
+  wire::Reader in{lie};
+  in.message();
+  in.pod<std::uint32_t>();
+  REQUIRE_THROWS_AS(in.str(), std::runtime_error);
+}
+
+TEST_CASE("Read frames from a stream", "[meta_wire]") {
+  wire::Writer first{wire::Message::Hello};
+  first.pod(wire::magic).pod(wire::version);
+  wire::Writer second{wire::Message::Exit};
+
+  std::stringstream stream;
+  first.send(stream);
+  second.send(stream);
+
+  std::string frame;
+  REQUIRE(wire::read_frame(stream, frame));
+  REQUIRE(frame == payload_of(first));
+  REQUIRE(wire::read_frame(stream, frame));
+  REQUIRE(frame == payload_of(second));
+  REQUIRE(!wire::read_frame(stream, frame));
+
+  // a size past the limit is a broken stream, nothing is allocated for it
+  std::stringstream too_large;
+  std::uint32_t size = wire::max_frame_size + 1;
+  too_large.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  too_large << "payload";
+  REQUIRE(!wire::read_frame(too_large, frame));
+
+  // the stream ends inside the payload
+  std::stringstream cut;
+  size = 100;
+  cut.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  cut << "payload";
+  REQUIRE(!wire::read_frame(cut, frame));
+}
+
+TEST_CASE("Check the element counts against the frame", "[meta_wire]") {
+  constexpr auto huge = std::numeric_limits<std::uint32_t>::max();
+
+  wire::Writer counts{wire::Message::Generate};
+  counts.pod(huge);
+  auto payload = payload_of(counts);
+  wire::Reader in{payload};
+  in.message();
+  REQUIRE_THROWS_AS(in.count(), std::runtime_error);
+
+  // as many elements as the frame can hold
+  wire::Writer fits{wire::Message::Generate};
+  fits.pod(std::uint32_t{2}).pod(std::uint32_t{0}).pod(std::uint32_t{0});
+  payload = payload_of(fits);
+  wire::Reader fitting{payload};
+  fitting.message();
+  REQUIRE(fitting.count(sizeof(std::uint32_t)) == 2);
+
+  // the qualifiers of a type and the methods of a class
+  wire::Writer qualifiers{wire::Message::Generate};
+  qualifiers.pod(huge);
+  payload = payload_of(qualifiers);
+  wire::Reader type_in{payload};
+  type_in.message();
+  REQUIRE_THROWS_AS(detail::read_qualifiers(type_in), std::runtime_error);
+
+  wire::Writer methods{wire::Message::Generate};
+  methods.str("A").pod(huge);
+  payload = payload_of(methods);
+  wire::Reader class_in{payload};
+  class_in.message();
+  REQUIRE_THROWS_AS(read_type(class_in), std::runtime_error);
+}
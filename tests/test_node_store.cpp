@@ -0,0 +1,102 @@
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <node_store.hpp>
+
+#include "catch.hpp"
+
+using Store = node_store::NodeStore<int, std::string, std::vector<int>>;
+
+TEST_CASE("Push and pop nodes in stack order", "[node_store]") {
+  Store store;
+  REQUIRE(store.empty());
+
+  store.push(1);
+  store.push(std::string{"a"});
+  store.push(2);
+  store.push(std::vector<int>{3, 4});
+  REQUIRE(store.size() == 4);
+
+  // the handles index the pool of their type
+  REQUIRE(store[0].is<int>());
+  REQUIRE(store[0].index == 0);
+  REQUIRE(store[1].is<std::string>());
+  REQUIRE(store[2].is<int>());
+  REQUIRE(store[2].index == 1);
+  REQUIRE(store.back().is<std::vector<int>>());
+  REQUIRE(store.get<int>(store[2]) == 2);
+  REQUIRE(store.get<std::string>(store[1]) == "a");
+
+  store.pop();
+  REQUIRE(store.back().is<int>());
+  store.pop();
+  REQUIRE(store.back().is<std::string>());
+
+  // the popped int was the last of its pool, its index is used again
+  store.push(5);
+  REQUIRE(store.back().index == 1);
+  REQUIRE(store.get<int>(store.back()) == 5);
+  REQUIRE(store.get<int>(store.front()) == 1);
+}
+
+TEST_CASE("Visit the node of a handle", "[node_store]") {
+  Store store;
+  store.push(7);
+  store.push(std::string{"abc"});
+  store.push(std::vector<int>{1, 2});
+
+  auto size_of = [](auto& node) -> std::size_t {
+    if constexpr (std::is_same_v<std::decay_t<decltype(node)>, int>) {
+      return static_cast<std::size_t>(node);
+    } else {
+      return node.size();
+    }
+  };
+  REQUIRE(store.visit(size_of, store[0]) == 7);
+  REQUIRE(store.visit(size_of, store[1]) == 3);
+  REQUIRE(store.visit(size_of, store[2]) == 2);
+
+  // the nodes are visited by reference
+  store.visit(
+      [](auto& node) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(node)>,
+                                     std::string>) {
+          node += "d";
+        }
+      },
+      store[1]);
+  REQUIRE(store.get<std::string>(store[1]) == "abcd");
+}
+
+TEST_CASE("Grow the pool of one type", "[node_store]") {
+  Store store;
+  auto& name = store.push(std::string{"kept"});
+  for (int i = 0; i < 1000; ++i) {
+    store.push(i);
+  }
+
+  // the pool of the ints moved as it grew, the string didn't
+  REQUIRE(&store.get<std::string>(store.front()) == &name);
+  REQUIRE(store.size() == 1001);
+  for (std::size_t i = 1; i < store.size(); ++i) {
+    REQUIRE(store.get<int>(store[i]) == static_cast<int>(i - 1));
+  }
+}
+
+TEST_CASE("Clear the nodes and keep the pools", "[node_store]") {
+  Store store;
+  for (int i = 0; i < 64; ++i) {
+    store.push(i);
+  }
+  auto* first = &store.get<int>(store.front());
+
+  store.clear();
+  REQUIRE(store.empty());
+
+  // the pool kept its memory, the next node is where the first one was
+  REQUIRE(&store.push(42) == first);
+  REQUIRE(store.size() == 1);
+  REQUIRE(store.front().index == 0);
+}
@@ -0,0 +1,87 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <output_sink.hpp>
+
+#include "catch.hpp"
+
+using std::string_literals::operator""s;
+namespace fs = std::filesystem;
+
+namespace {
+std::string read_file(fs::path const& path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+/**
+ * The number of files beside path whose name starts with the name of path
+ */
+std::size_t count_beside(fs::path const& path) {
+  auto name = path.filename().string();
+  std::size_t count = 0;
+  for (auto& entry : fs::directory_iterator(path.parent_path())) {
+    count += entry.path().filename().string().rfind(name, 0) == 0;
+  }
+  return count;
+}
+}  // namespace
+
+TEST_CASE("Write an output through a temporary file", "[output_sink]") {
+  auto path = fs::temp_directory_path() / "zero_preprocessor_test.out";
+  fs::remove(path);
+
+  // small spans are buffered, one larger than the buffer is written directly
+  std::string large(200000, 'x');
+  std::string expected;
+  {
+    source::OutputSink out{path};
+    REQUIRE(out);
+    for (int i = 0; i < 10000; ++i) {
+      out << "line " << static_cast<char>('0' + i % 10) << '\n';
+      expected += "line "s + static_cast<char>('0' + i % 10) + '\n';
+    }
+    out.write(large);
+    expected += large;
+    out.put('!');
+    expected += '!';
+
+    // nothing is visible before the commit
+    REQUIRE(!fs::exists(path));
+    REQUIRE(count_beside(path) == 1);
+    REQUIRE(out.commit());
+  }
+  REQUIRE(count_beside(path) == 1);
+  REQUIRE(read_file(path) == expected);
+
+  // without a commit the output is kept and the temporary file removed
+  {
+    source::OutputSink out{path};
+    out << "discarded";
+  }
+  REQUIRE(count_beside(path) == 1);
+  REQUIRE(read_file(path) == expected);
+
+  // the sinks of the same output don't share their temporary file
+  {
+    source::OutputSink first{path};
+    source::OutputSink second{path};
+    first << "first";
+    second << "second";
+    REQUIRE(count_beside(path) == 3);
+    REQUIRE(first.commit());
+    REQUIRE(second.commit());
+  }
+  REQUIRE(read_file(path) == "second");
+
+  fs::remove(path);
+}
+
+TEST_CASE("Fail to open an output", "[output_sink]") {
+  source::OutputSink out{fs::temp_directory_path() / "no_such_dir" / "a.out"};
+  REQUIRE(!out);
+  out << "dropped";
+  REQUIRE(!out.commit());
+}
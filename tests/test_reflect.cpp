@@ -0,0 +1,206 @@
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "reflect_flat.hpp"
+#include "reflect_tuple.hpp"
+
+#include "catch.hpp"
+
+using reflect::get_element_t;
+using reflect::get_name_v;
+using reflect::get_size_v;
+
+/**
+ * The offset of the member in T, to compare the pointers of the two layouts
+ * whose classes are different
+ */
+template <class T, class M>
+std::ptrdiff_t offset_of(M T::*pointer) {
+  T object{};
+  return reinterpret_cast<const char*>(&(object.*pointer)) -
+         reinterpret_cast<const char*>(&object);
+}
+
+/**
+ * Check that the data members of both lists have the same names, types and
+ * offsets in the same order
+ */
+template <class Tuple, class Flat, std::size_t... Is>
+void require_same_members(std::index_sequence<Is...>) {
+  [[maybe_unused]] auto same_member = [](auto tuple, auto flat) {
+    using T = typename decltype(tuple)::type;
+    using F = typename decltype(flat)::type;
+    REQUIRE(std::string_view{get_name_v<T>} == get_name_v<F>);
+    REQUIRE(std::is_same_v<reflect::get_type_t<T>, reflect::get_type_t<F>>);
+    REQUIRE(offset_of(reflect::get_pointer_v<T>) ==
+            offset_of(reflect::get_pointer_v<F>));
+  };
+  (same_member(std::common_type<get_element_t<Is, Tuple>>{},
+               std::common_type<get_element_t<Is, Flat>>{}),
+   ...);
+}
+
+template <class Tuple, class Flat>
+void require_same_members() {
+  REQUIRE(get_size_v<Tuple> == get_size_v<Flat>);
+  require_same_members<Tuple, Flat>(
+      std::make_index_sequence<get_size_v<Tuple>>{});
+}
+
+TEST_CASE("Flat and tuple layouts reflect the same members", "[reflect]") {
+  using Tuple = reflexpr<Point_tuple>;
+  using Flat = reflexpr<Point_flat>;
+  static_assert(!reflect::helper::is_flat_v<Tuple>);
+  static_assert(reflect::helper::is_flat_v<Flat>);
+
+  require_same_members<reflect::get_data_members_t<Tuple>,
+                       reflect::get_data_members_t<Flat>>();
+  require_same_members<reflect::get_public_data_members_t<Tuple>,
+                       reflect::get_public_data_members_t<Flat>>();
+  REQUIRE(get_size_v<reflect::get_data_members_t<Flat>> == 4);
+  REQUIRE(get_size_v<reflect::get_public_data_members_t<Flat>> == 3);
+  using Label = get_element_t<3, reflect::get_data_members_t<Flat>>;
+  REQUIRE(std::string_view{get_name_v<Label>} == "label");
+
+  require_same_members<reflect::get_data_members_t<reflexpr<Base_tuple>>,
+                       reflect::get_data_members_t<reflexpr<Base_flat>>>();
+  require_same_members<reflect::get_data_members_t<reflexpr<Empty_tuple>>,
+                       reflect::get_data_members_t<reflexpr<Empty_flat>>>();
+  REQUIRE(get_size_v<reflect::get_data_members_t<reflexpr<Empty_flat>>> == 0);
+}
+
+TEST_CASE("Flat and tuple layouts reflect the same bases", "[reflect]") {
+  using TupleBases = reflect::get_base_classes_t<reflexpr<Point_tuple>>;
+  using FlatBases = reflect::get_base_classes_t<reflexpr<Point_flat>>;
+  REQUIRE(get_size_v<TupleBases> == 1);
+  REQUIRE(get_size_v<FlatBases> == 1);
+  REQUIRE(std::is_same_v<get_element_t<0, TupleBases>, Base_tuple>);
+  REQUIRE(std::is_same_v<get_element_t<0, FlatBases>, Base_flat>);
+  REQUIRE(get_size_v<reflect::get_public_base_classes_t<
+              reflexpr<Point_flat>>> == 1);
+
+  REQUIRE(get_size_v<reflect::get_base_classes_t<reflexpr<Empty_tuple>>> == 0);
+  REQUIRE(get_size_v<reflect::get_base_classes_t<reflexpr<Empty_flat>>> == 0);
+}
+
+TEST_CASE("Flat and tuple layouts reflect the same enumerators", "[reflect]") {
+  using Tuple = reflect::get_enumerators_t<reflexpr<Color_tuple>>;
+  using Flat = reflect::get_enumerators_t<reflexpr<Color_flat>>;
+  REQUIRE(get_size_v<Tuple> == 3);
+  REQUIRE(get_size_v<Flat> == 3);
+
+  auto same_enumerator = [](auto tuple, auto flat) {
+    using T = typename decltype(tuple)::type;
+    using F = typename decltype(flat)::type;
+    REQUIRE(std::string_view{get_name_v<T>} == get_name_v<F>);
+    REQUIRE(static_cast<int>(reflect::get_constant_v<T>) ==
+            static_cast<int>(reflect::get_constant_v<F>));
+  };
+  same_enumerator(std::common_type<get_element_t<0, Tuple>>{},
+                  std::common_type<get_element_t<0, Flat>>{});
+  same_enumerator(std::common_type<get_element_t<1, Tuple>>{},
+                  std::common_type<get_element_t<1, Flat>>{});
+  same_enumerator(std::common_type<get_element_t<2, Tuple>>{},
+                  std::common_type<get_element_t<2, Flat>>{});
+
+  REQUIRE(reflect::get_constant_v<get_element_t<1, Flat>> == Color_flat::green);
+  REQUIRE(std::string_view{get_name_v<get_element_t<2, Flat>>} == "blue");
+  REQUIRE(reflect::is_scoped_enum_v<reflexpr<Color_flat>>);
+  using Underlying = reflect::get_underlying_type_t<reflexpr<Color_flat>>;
+  REQUIRE(std::is_same_v<
+          Underlying, reflect::get_underlying_type_t<reflexpr<Color_tuple>>>);
+}
+
+/**
+ * The member iteration of the reflection of Point in one of the layouts
+ */
+template <class Point, class Empty>
+void require_member_iteration() {
+  Point point;
+  point.x = 1;
+  point.y = 2.5;
+  point.history = {3, 4};
+  point.set_label("private");
+
+  std::string names;
+  reflect::for_each_member(point, [&names](auto name, auto&) {
+    names += name;
+    names += ';';
+  });
+  REQUIRE(names == "x;y;history;label;");
+
+  // the members are visited by reference
+  reflect::for_each_member(point, [](auto, auto& value) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(value)>, int>) {
+      value = 10;
+    }
+  });
+  REQUIRE(point.x == 10);
+
+  Point const& constant = point;
+  std::size_t sizes = 0;
+  reflect::for_each_member(constant, [&sizes](auto, auto& value) {
+    static_assert(std::is_const_v<std::remove_reference_t<decltype(value)>>);
+    sizes += sizeof(value);
+  });
+  REQUIRE(sizes == sizeof(int) + sizeof(double) + sizeof(std::vector<int>) +
+                       sizeof(std::string));
+
+  auto sizes_of = reflect::transform_members(
+      constant, [](auto, auto& value) { return sizeof(value); });
+  REQUIRE(std::tuple_size_v<decltype(sizes_of)> == 4);
+  REQUIRE(std::get<1>(sizes_of) == sizeof(double));
+
+  auto name_at = [&point](std::size_t index) {
+    return reflect::visit_member(
+        point, index, [](auto name, auto&) { return std::string_view{name}; });
+  };
+  REQUIRE(name_at(0) == "x");
+  REQUIRE(name_at(3) == "label");
+  REQUIRE_THROWS_AS(name_at(4), std::out_of_range);
+
+  // the same reference type for all the members is returned as is
+  auto as_bytes = [](auto, auto& value) -> auto& {
+    return reinterpret_cast<char&>(value);
+  };
+  using Bytes = decltype(reflect::visit_member(point, 0, as_bytes));
+  static_assert(std::is_same_v<Bytes, char&>);
+  REQUIRE(&reflect::visit_member(point, 3, as_bytes) ==
+          reinterpret_cast<const char*>(&point.get_label()));
+
+  // different types are returned as their common type
+  auto numbers = [](auto, auto& value) {
+    if constexpr (std::is_arithmetic_v<std::decay_t<decltype(value)>>) {
+      return value;
+    } else {
+      return value.size();
+    }
+  };
+  using Number = decltype(reflect::visit_member(point, 0, numbers));
+  static_assert(std::is_same_v<Number, double>);
+  REQUIRE(reflect::visit_member(point, 1, numbers) == 2.5);
+  REQUIRE(reflect::visit_member(point, 2, numbers) == 2);
+
+  Empty empty;
+  int calls = 0;
+  reflect::for_each_member(empty, [&calls](auto, auto&) { ++calls; });
+  REQUIRE(calls == 0);
+  auto none = reflect::transform_members(empty, [](auto, auto&) { return 0; });
+  REQUIRE(std::tuple_size_v<decltype(none)> == 0);
+  REQUIRE_THROWS_AS(reflect::visit_member(empty, 0, [](auto, auto&) {}),
+                    std::out_of_range);
+}
+
+TEST_CASE("Iterate the members of the tuple layout", "[reflect]") {
+  require_member_iteration<Point_tuple, Empty_tuple>();
+}
+
+TEST_CASE("Iterate the members of the flat layout", "[reflect]") {
+  require_member_iteration<Point_flat, Empty_flat>();
+}
@@ -0,0 +1,61 @@
+#include <iterator>
+#include <string>
+#include <variant>
+
+#include <source.hpp>
+#include <std_parser.hpp>
+
+#include "catch.hpp"
+
+TEST_CASE("Locate the unprocessed part of a source", "[source]") {
+  Source source{"ab\ncd\n\nefg", "locations"};
+  REQUIRE(source.get_row() == 1);
+  REQUIRE(source.get_column() == 1);
+
+  source.advance(1);
+  REQUIRE(source.get_row() == 1);
+  REQUIRE(source.get_column() == 2);
+
+  // past a line end and then inside the line
+  source.advance(3);
+  REQUIRE(source.get_row() == 2);
+  REQUIRE(source.get_column() == 2);
+  source.advance(1);
+  REQUIRE(source.get_column() == 3);
+
+  // an empty line
+  source.advance(1);
+  REQUIRE(source.get_row() == 3);
+  REQUIRE(source.get_column() == 1);
+
+  source.advance(3);
+  REQUIRE(source.get_row() == 4);
+  REQUIRE(source.get_column() == 3);
+  source.advance(1);
+  REQUIRE(source.is_finished());
+  REQUIRE(source.get_column() == 4);
+}
+
+TEST_CASE("Locate the parsed nodes", "[source]") {
+  Source source{"int a;\n\n  struct A {\n    int b;\n  };\n", "nodes"};
+  std_parser::StdParserState parser;
+  while (!source.is_finished()) {
+    auto out = parser.parse(source);
+    REQUIRE(out);
+    source.advance(std::distance(source.begin(), out->processed_to));
+  }
+
+  auto& top = parser.get_top_code_fragment();
+  auto& classes = top.get_all_code_fragments();
+  REQUIRE(!classes.empty());
+  // the class is located at its class key
+  auto located = false;
+  for (auto& fragment : classes) {
+    if (auto cls = std::get_if<std_parser::rules::ast::Class>(&fragment)) {
+      REQUIRE(cls->loc.row == 3);
+      REQUIRE(cls->loc.col == 3);
+      located = true;
+    }
+  }
+  REQUIRE(located);
+}
@@ -1,9 +1,14 @@
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <set>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
+#include <source.hpp>
 #include <std_parser.hpp>
 
 #include "catch.hpp"
@@ -52,49 +57,44 @@ class CanParse : public Catch::MatcherBase<std::string> {
         auto& c = parser.get_all_code_fragments();
         std::cout << "inside " << c.size() << " can't parse " << left
                   << std::endl;
-        for (auto& v : c) {
-          std::visit(overloaded{[&](rules::ast::Namespace const&) {
-                                  std::cout << "namespace " << std::endl;
-                                },
-                                [&](rules::ast::Class const&) {
-                                  std::cout << "class " << std::endl;
-                                },
-                                [&](rules::ast::Function const&) {
-                                  std::cout << "function " << std::endl;
-                                },
-                                [&](rules::ast::Scope const&) {
-                                  std::cout << "local scope " << std::endl;
-                                },
-                                [&](rules::ast::Enumeration const&) {
-                                  std::cout << "enum " << std::endl;
-                                },
-                                [&](rules::ast::Statement const&) {
-                                  std::cout << "Statement " << std::endl;
-                                },
-                                [&](rules::ast::Expression const& arg) {
-                                  std::cout << "expression " << arg.is_begin()
-                                            << std::endl;
-                                },
-                                [&](rules::ast::RoundExpression const& arg) {
-                                  std::cout << "round expression "
-                                            << arg.is_begin() << std::endl;
-                                },
-                                [&](rules::ast::CurlyExpression const& arg) {
-                                  std::cout << "curly expression "
-                                            << arg.is_begin() << std::endl;
-                                },
-                                [&](rules::ast::Vars const& arg) {
-                                  std::cout << "vars "
-                                            << static_cast<int>(arg.state)
-                                            << std::endl;
-                                },
-                                [&](rules::ast::IfExpression const& arg) {
-                                  std::cout << "if expression "
-                                            << static_cast<int>(arg.state)
-                                            << std::endl;
-                                },
-                                [](auto&) {}},
-                     v);
+        auto print = overloaded{
+            [&](rules::ast::Namespace const&) {
+              std::cout << "namespace " << std::endl;
+            },
+            [&](rules::ast::Class const&) {
+              std::cout << "class " << std::endl;
+            },
+            [&](rules::ast::Function const&) {
+              std::cout << "function " << std::endl;
+            },
+            [&](rules::ast::Scope const&) {
+              std::cout << "local scope " << std::endl;
+            },
+            [&](rules::ast::Enumeration const&) {
+              std::cout << "enum " << std::endl;
+            },
+            [&](rules::ast::Statement const&) {
+              std::cout << "Statement " << std::endl;
+            },
+            [&](rules::ast::Expression const& arg) {
+              std::cout << "expression " << arg.is_begin() << std::endl;
+            },
+            [&](rules::ast::RoundExpression const& arg) {
+              std::cout << "round expression " << arg.is_begin() << std::endl;
+            },
+            [&](rules::ast::CurlyExpression const& arg) {
+              std::cout << "curly expression " << arg.is_begin() << std::endl;
+            },
+            [&](rules::ast::Vars const& arg) {
+              std::cout << "vars " << static_cast<int>(arg.state) << std::endl;
+            },
+            [&](rules::ast::IfExpression const& arg) {
+              std::cout << "if expression " << static_cast<int>(arg.state)
+                        << std::endl;
+            },
+            [](auto&) {}};
+        for (auto v : c) {
+          parser.visit_code_fragment(print, v);
         }
         return false;
       }
@@ -147,6 +147,45 @@ TEST_CASE("Parse valid variables", "[var]") {
   }
 }
 
+TEST_CASE("Parse declarations starting with any token", "[declaration]") {
+  // names starting with a keyword must not be taken for the keyword
+  std::array namespace_declarations{
+      "classy_type c;"s,
+      "enumerator e;"s,
+      "namespaces n;"s,
+      "class A;"s,
+      "struct B : public A {};"s,
+      "enum class E : int { A, B };"s,
+      "template <typename T> void foo(T t);"s,
+      "int foo(int a) { return a; }"s,
+      "bool operator==(A a, B b);"s,
+      "namespace a { int b; }"s,
+      "// comment\n"s,
+      "#include <vector>\n"s};
+
+  for (auto& declaration : namespace_declarations) {
+    REQUIRE_THAT(declaration, CanParse("namespace declaration"));
+  }
+
+  rules::ast::Class cls{
+      rules::ast::class_or_struct{{}, rules::ast::class_type::CLASS, "A", {}}};
+  std::array class_declarations{
+      "public: int a;"s,
+      "publicity p;"s,
+      "private_type p;"s,
+      "void foo() const;"s,
+      "virtual int get() const override { return 1; }"s,
+      "A(int a) : a{a} {}"s,
+      "~A() {}"s,
+      "enum E { A, B };"s,
+      "class C;"s,
+      "template <typename T> struct D {};"s};
+
+  for (auto& declaration : class_declarations) {
+    REQUIRE_THAT(declaration, CanParse("class declaration", cls));
+  }
+}
+
 TEST_CASE("Parse valid if expression", "[if_expression]") {
   std::array valid_if_expressions{"if (true)"s,
                                   "if(a || b)"s,
@@ -193,3 +232,216 @@ TEST_CASE("Parse valid expression", "[expression]") {
                  CanParse("expression", rules::ast::Expression{}));
   }
 }
+
+TEST_CASE("Get the includes of a source", "[get_includes]") {
+  struct {
+    std::string content;
+
+    auto begin() const { return content.begin(); }
+    auto end() const { return content.end(); }
+  } source;
+
+  auto get_includes = [&](std::string content) {
+    source.content = std::move(content);
+    StdParserState parser;
+    auto includes = parser.get_includes(source);
+    return std::set<std::string>(includes.begin(), includes.end());
+  };
+
+  using Includes = std::set<std::string>;
+
+  REQUIRE(get_includes("") == Includes{});
+  REQUIRE(get_includes("#include <vector>") == Includes{"vector"});
+  REQUIRE(get_includes("#include \"a.hpp\"\n#include <b>\n") ==
+          Includes{"a.hpp", "b"});
+  REQUIRE(get_includes("  \t#  include \"a.hpp\"\r\n\t#include<b>") ==
+          Includes{"a.hpp", "b"});
+  REQUIRE(get_includes("#include \"a.hpp\" #include \"b.hpp\"\n") ==
+          Includes{"a.hpp", "b.hpp"});
+  REQUIRE(get_includes("#define A #include \"a.hpp\"\n#include \"b.hpp\"") ==
+          Includes{"b.hpp"});
+  REQUIRE(get_includes("int a; #include \"a.hpp\"\n// #include \"b.hpp\"\n") ==
+          Includes{});
+  REQUIRE(get_includes("#pragma once\r#include \"a.hpp\"\rint a = '#';") ==
+          Includes{"a.hpp"});
+  REQUIRE(get_includes("#include\n\"a.hpp\"\n#include \"b") == Includes{"a.hpp"});
+}
+
+TEST_CASE("Reset the parser after a file", "[reset]") {
+  std::string content = "#include \"a.hpp\"\nstruct A {\n  int a;\n};\n";
+  struct {
+    std::string::iterator begin_;
+    std::string::iterator end_;
+
+    std::uint16_t row = 0;
+    std::uint16_t col = 0;
+
+    auto get_row() { return row; }
+    auto get_column() { return col; }
+
+    auto begin() { return begin_; }
+    auto end() { return end_; }
+  } source{content.begin(), content.end()};
+
+  StdParserState parser;
+  auto parse_all = [&] {
+    source.begin_ = content.begin();
+    while (source.begin_ != source.end_) {
+      auto out = parser.parse(source);
+      REQUIRE(out);
+      source.begin_ = out->processed_to;
+    }
+  };
+
+  parse_all();
+  REQUIRE(parser.get_top_code_fragment().get_all_code_fragments().size() == 1);
+  REQUIRE(parser.get_all_includes().size() == 1);
+
+  parser.reset();
+  REQUIRE(parser.get_all_code_fragments().size() == 1);
+  REQUIRE(parser.get_top_code_fragment().get_all_code_fragments().empty());
+  REQUIRE(parser.get_all_includes().empty());
+
+  parse_all();
+  REQUIRE(parser.get_top_code_fragment().get_all_code_fragments().size() == 1);
+}
+
+TEST_CASE("Memoized rules parse like the plain ones", "[memo]") {
+  // the offsets where every parsed statement ends
+  auto statement_ends = [](std::string const& content, bool memoize) {
+    struct {
+      std::string::const_iterator begin_;
+      std::string::const_iterator end_;
+
+      std::uint16_t row = 0;
+      std::uint16_t col = 0;
+
+      auto get_row() { return row; }
+      auto get_column() { return col; }
+
+      auto begin() { return begin_; }
+      auto end() { return end_; }
+    } source{content.begin(), content.end()};
+
+    StdParserState parser;
+    parser.set_memoization(memoize);
+    std::vector<long> ends;
+    while (source.begin_ != source.end_) {
+      auto out = parser.parse(source);
+      if (!out) {
+        break;
+      }
+      source.begin_ = out->processed_to;
+      ends.push_back(std::distance(content.begin(), source.begin_));
+    }
+    return ends;
+  };
+
+  std::array sources{
+      "void f() { bool b = a < b < c < d; }"s,
+      "void g(int a = f<A<f<A<2>>(1)>>(1));"s,
+      "struct A { std::map<std::pair<int, int>, int> m; A() : m{} {} };"s,
+      "int a = f(g(1), A{2, h<int>(3)}, (4 + 5));"s,
+      "template <class T> struct B : A<T, 1> { void f(T t = T{}) {} };"s};
+  for (auto& content : sources) {
+    INFO(content);
+    REQUIRE(statement_ends(content, true) == statement_ends(content, false));
+  }
+}
+
+TEST_CASE("Reuse a parser for a new text in the same memory", "[reuse]") {
+  std::string content = "A<B  c;";
+  struct {
+    std::string::iterator begin_;
+    std::string::iterator end_;
+
+    std::uint16_t row = 0;
+    std::uint16_t col = 0;
+
+    auto get_row() { return row; }
+    auto get_column() { return col; }
+
+    auto begin() { return begin_; }
+    auto end() { return end_; }
+  } source{content.begin(), content.end()};
+
+  // parses up to the statement it can't parse
+  auto parse_all = [&source](StdParserState& parser) {
+    while (source.begin_ != source.end_) {
+      auto out = parser.parse(source);
+      if (!out) {
+        break;
+      }
+      source.begin_ = out->processed_to;
+    }
+  };
+
+  StdParserState parser;
+  parse_all(parser);
+  REQUIRE(source.begin_ == content.begin());
+
+  // the same length is written over the same characters
+  content.replace(0, content.size(), "A<B> c;");
+  source.begin_ = content.begin();
+  parse_all(parser);
+  REQUIRE(source.begin_ == content.end());
+}
+
+TEST_CASE("Reuse a parser for two sources in the same memory", "[reuse]") {
+  auto buffer = std::make_shared<std::string>("int a; A<B  c;");
+  // parses up to the statement it can't parse
+  auto parse_all = [](StdParserState& parser, Source& source) {
+    while (!source.is_finished()) {
+      auto begin = source.begin();
+      auto out = parser.parse(source);
+      if (!out) {
+        break;
+      }
+      source.advance(std::distance(begin, out->processed_to));
+    }
+  };
+
+  StdParserState parser;
+  Source first{buffer, *buffer, "first"};
+  parse_all(parser, first);
+  REQUIRE(!first.is_finished());
+
+  buffer->replace(0, buffer->size(), "int a; A<B> c;");
+  Source second{buffer, *buffer, "second"};
+  // starts after the first statement, where the first source was left
+  second.advance(&*first.begin() - buffer->data());
+  parse_all(parser, second);
+  REQUIRE(second.is_finished());
+}
+
+TEST_CASE("Tokenized statements parse like the plain ones", "[tokens]") {
+  // how far the source was parsed and the declarations found in it, the
+  // tokens take the blanks between two statements in one
+  auto parse_all = [](std::string const& content, bool tokenize) {
+    auto source = Source{content, "tokens"};
+    StdParserState parser;
+    parser.set_tokenization(tokenize);
+    while (!source.is_finished()) {
+      auto begin = source.begin();
+      auto out = parser.parse(source);
+      if (!out) {
+        break;
+      }
+      source.advance(std::distance(begin, out->processed_to));
+    }
+    return std::pair{
+        source.is_finished(),
+        parser.get_top_code_fragment().get_all_code_fragments().size()};
+  };
+
+  std::array sources{
+      "#include \"a.hpp\"\n// a comment\nstruct A {\n  /* a */ int a;\n};\n"s,
+      "namespace n {\n\n  enum class E { a, b };\n  void f() {\n    g(); }\n}\n"s,
+      "template <class T>\nclass B : public A {\n public:\n  T t;\n};\n"s};
+  for (auto& content : sources) {
+    INFO(content);
+    auto tokenized = parse_all(content, true);
+    REQUIRE(tokenized.first);
+    REQUIRE(tokenized == parse_all(content, false));
+  }
+}
@@ -0,0 +1,82 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/spirit/home/x3.hpp>
+
+#include <std_rules.hpp>
+#include <symbol_table.hpp>
+
+#include "catch.hpp"
+
+using symbols::Symbol;
+
+TEST_CASE("Intern equal strings once", "[symbol_table]") {
+  std::string name = "value_type";
+  Symbol a{name};
+  Symbol b{"value_type"};
+  REQUIRE(a == b);
+  REQUIRE(a.str() == "value_type");
+  REQUIRE(&a.str() == &b.str());
+  REQUIRE(std::hash<Symbol>{}(a) == std::hash<Symbol>{}(b));
+
+  REQUIRE(Symbol{"size_type"} != a);
+  REQUIRE(Symbol{}.empty());
+  REQUIRE(Symbol{""} == Symbol{});
+}
+
+TEST_CASE("Intern in separate tables", "[symbol_table]") {
+  symbols::SymbolTable a{4};
+  auto in_a = a.intern("separate");
+  REQUIRE(a.intern("separate") == in_a);
+  {
+    // the strings this thread found in a aren't returned by another table
+    symbols::SymbolTable b{4};
+    auto in_b = b.intern("separate");
+    REQUIRE(in_b != in_a);
+    REQUIRE(*in_b == "separate");
+    REQUIRE(b.size() == 1);
+  }
+  REQUIRE(a.intern("separate") == in_a);
+
+  // a new table at the same address doesn't get the strings of the old one
+  auto table = std::make_unique<symbols::SymbolTable>(4);
+  table->intern("reused");
+  table = std::make_unique<symbols::SymbolTable>(4);
+  table->intern("reused");
+  REQUIRE(table->size() == 1);
+}
+
+TEST_CASE("Intern from many threads", "[symbol_table]") {
+  std::vector<std::vector<Symbol>> interned(4);
+  std::vector<std::thread> threads;
+  for (auto& symbols : interned) {
+    threads.emplace_back([&symbols] {
+      for (int i = 0; i < 1000; ++i) {
+        symbols.emplace_back("name_" + std::to_string(i));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (auto& symbols : interned) {
+    REQUIRE(symbols == interned.front());
+  }
+  std::unordered_set<Symbol> distinct(interned.front().begin(),
+                                      interned.front().end());
+  REQUIRE(distinct.size() == 1000);
+}
+
+TEST_CASE("Parse a qualified name into symbols", "[symbol_table]") {
+  namespace x3 = boost::spirit::x3;
+  std::string input = "meta::type";
+  std_parser::rules::ast::Type_ type;
+  auto begin = input.begin();
+  REQUIRE(x3::parse(begin, input.end(), std_parser::rules::type_, type));
+  REQUIRE(begin == input.end());
+  REQUIRE(type == std_parser::rules::ast::Type_{"meta", "type"});
+}
@@ -0,0 +1,46 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <trace.hpp>
+
+#include "catch.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE("traces are appended to one chrome trace", "[trace]") {
+  auto path = fs::temp_directory_path() / "zero_preprocessor_test.trace.json";
+  fs::remove(path);
+
+  auto start = trace::Clock::now();
+  {
+    trace::Trace first{path};
+    first.set_process_name("main 1");
+    first.complete("io", "load_source", start, start, "a \"quoted\"\\path");
+  }
+  {
+    trace::Trace second{path};
+    second.async("meta", "gen_meta_class", 3, start, start);
+  }
+  // a disabled trace writes nothing
+  trace::Trace{""}.complete("io", "write", start, start);
+
+  std::ifstream in(path);
+  std::string content{std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>()};
+
+  // only the first process starts the array
+  REQUIRE(content.rfind("[\n", 0) == 0);
+  REQUIRE(content.find('[', 1) == std::string::npos);
+  REQUIRE(content.find("\"name\":\"process_name\"") != std::string::npos);
+  REQUIRE(content.find("\"args\":{\"name\":\"main 1\"}") != std::string::npos);
+  REQUIRE(content.find("\"ph\":\"X\"") != std::string::npos);
+  REQUIRE(content.find("\"detail\":\"a \\\"quoted\\\"\\\\path\"") !=
+          std::string::npos);
+  REQUIRE(content.find("\"ph\":\"b\"") != std::string::npos);
+  REQUIRE(content.find("\"ph\":\"e\"") != std::string::npos);
+  REQUIRE(content.find("\"write\"") == std::string::npos);
+
+  fs::remove(path);
+}